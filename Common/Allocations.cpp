@@ -0,0 +1,79 @@
+#include "Allocations.h"
+
+static volatile LONG Watches		= 0;		// alive
+static volatile LONG Allocations	= 0;		// made while any was
+static volatile DWORD Watching		= 0;		// the thread the last watch was made on
+
+static volatile DWORD Helpers[ALLOCATION_THREADS];		// which count as its own
+static volatile LONG HelperCount	= 0;
+
+static bool Counted(DWORD thread)
+{
+	if (thread == Watching)
+		return true;
+
+	for (LONG i = 0 ; i < HelperCount ; i++)
+		if (Helpers[i] == thread)
+			return true;
+
+	return false;
+}
+
+#ifdef _DEBUG
+	static _CRT_ALLOC_HOOK PreviousHook = NULL;
+	static bool Hooked = false;
+
+	static int __cdecl CountAllocations(int type, void* data, size_t size, int blockType, long request, const unsigned char* file, int line)
+	{
+		// (not the CRT's own blocks, which it may take on any call)
+		if ((Watches > 0) && ((type == _HOOK_ALLOC) || (type == _HOOK_REALLOC)) && (blockType != _CRT_BLOCK) && Counted(GetCurrentThreadId()))
+			InterlockedIncrement(&Allocations);
+
+		return (PreviousHook != NULL) ? PreviousHook(type, data, size, blockType, request, file, line) : TRUE;
+	}
+#endif
+
+AllocationWatch::AllocationWatch()
+{
+	#ifdef _DEBUG
+		if (!Hooked)
+		{
+			PreviousHook	= _CrtSetAllocHook(CountAllocations);
+			Hooked			= true;
+		}
+	#endif
+
+	Watching = GetCurrentThreadId();
+
+	this->start = Allocations;
+	InterlockedIncrement(&Watches);
+}
+
+AllocationWatch::~AllocationWatch()
+{
+	InterlockedDecrement(&Watches);
+}
+
+long AllocationWatch::count() const
+{
+	return Allocations - start;
+}
+
+bool AllocationWatch::Counting()
+{
+	#ifdef _DEBUG
+		return true;
+	#else
+		return false;
+	#endif
+}
+
+void AllocationWatch::CountThread(DWORD thread)
+{
+	// (the thread's put in place before it's counted in, so the hook never sees a slot half filled)
+	if (HelperCount < ALLOCATION_THREADS)
+	{
+		Helpers[HelperCount] = thread;
+		InterlockedIncrement(&HelperCount);
+	}
+}
@@ -0,0 +1,30 @@
+#ifndef _ALLOCATIONS_H_
+#define _ALLOCATIONS_H_
+
+#include <windows.h>
+#include <crtdbg.h>
+
+#define STEADY_FRAMES	300		// frames after the crowd last changed size before a frame is expected not to allocate at all
+
+#define ALLOCATION_THREADS	64		// most threads which may count as the watching thread's own
+
+// Counts the heap allocations made while it's alive, through the debug CRT's allocation hook; for checking that the frame loop doesn't go to
+// the heap once it's warmed up, as the allocator's occasional long calls would show in the frame times.  Only allocations on the thread the
+// watch was made on count, and on the threads added with CountThread() (the workers its loops are shared with), not those of any other
+// thread working alongside the frame (building flow fields, writing a recording...).  Release builds have no hook, so count nothing (and
+// Counting() is false).
+class AllocationWatch
+{
+	public:
+		AllocationWatch();
+		~AllocationWatch();
+
+		long count() const;					// allocations since this watch began
+		static bool Counting();
+		static void CountThread(DWORD thread);		// as a watching thread's own, from now on
+
+	private:
+		LONG start;
+};
+
+#endif
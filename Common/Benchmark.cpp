@@ -0,0 +1,42 @@
+#include "Benchmark.h"
+
+Benchmark::Benchmark(const char* filename)
+{
+	__int64 cntsPerSec = 0;
+
+	QueryPerformanceFrequency((LARGE_INTEGER*)&cntsPerSec);
+	this->secsPerCnt = 1.0 / (double)cntsPerSec;
+
+	this->startTimeStamp = 0;
+
+	if (filename != NULL)
+		Log.open(filename);
+}
+
+Benchmark::~Benchmark()
+{
+	Log.close();
+}
+
+void Benchmark::Start()
+{
+	QueryPerformanceCounter((LARGE_INTEGER*)&this->startTimeStamp);
+}
+
+double Benchmark::Stop()
+{
+	__int64 currTimeStamp = 0;
+	QueryPerformanceCounter((LARGE_INTEGER*)&currTimeStamp);
+
+	return (currTimeStamp - this->startTimeStamp) * this->secsPerCnt;
+}
+
+void Benchmark::Report(const char* name, double value, const char* units)
+{
+	Log << name << ": " << value << " " << units << std::endl;
+}
+
+void Benchmark::Section(const char* name)
+{
+	Log << std::endl << "[" << name << "]" << std::endl;
+}
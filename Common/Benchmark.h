@@ -0,0 +1,27 @@
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <windows.h>
+#include <fstream>
+
+// Wall-clock timing for the benchmark runs, with the results written to a plain text log one line at a time.  
+class Benchmark
+{
+	public:
+		Benchmark(const char* filename = NULL);					// NULL just for timing, with no log
+		~Benchmark();
+
+		void Start();
+		double Stop();											// seconds since the last Start
+
+		void Report(const char* name, double value, const char* units);
+		void Section(const char* name);
+
+	private:
+		std::ofstream	Log;
+
+		double			secsPerCnt;
+		__int64			startTimeStamp;
+};
+
+#endif
@@ -1,49 +1,205 @@
 #include "OpenSteer/Boid.h"
-
-Boid::Boid(ProximityDatabase& pd, BoxObstacle* obstacles)
+#include "OpenSteer/Group.h"
+#include "OpenSteer/Script.h"
+#include "OpenSteer/Pool.h"
+
+bool Boid::UseAggregates = false;
+bool Boid::UseOrca = false;
+CrowdGrid* Boid::Crowd = NULL;
+ProfileTable* Boid::Profiles = NULL;
+const BehaviourProfile Boid::DefaultProfile;
+unsigned int Boid::Seed = 0;
+unsigned int Boid::Spawned = 0;
+ThinkScheduler* Boid::Thinking = NULL;
+int Boid::ThinkAvoid = -1;
+int Boid::ThinkFlow = -1;
+
+// (neighbours & scratch space live in the threads' arenas, not in each boid, to keep to this; a new member must fit the budgets of both
+// Win32 and x64, and a build failing here wants the member packed in, or the budget for that platform raised knowingly)
+typedef char BoidBudgetCheck[(sizeof(Boid) <= AGENT_BUDGET) ? 1 : -1];
+
+Boid::Boid(ProximityDatabase& pd, Obstacle* obstacles, int profile, const Vec3* position)
 {
 	proximityToken	= pd.allocateToken(this);	// allocate a token for this boid in the proximity database
+	this->database	= &pd;
 	this->obstacles = obstacles;
 
-	reset();							// reset all boid state
-
-	this->Separation	= new Force(1.0f, -0.707f, 12.0f);
-	this->Alignment		= new Force(1.0f, 0.7f, 8.0f);
-	this->Cohesion		= new Force(1.0f, -0.15f, 8.0f);
-
-	this->maxRadius = max(Separation->Radius, max(Alignment->Radius, Cohesion->Radius));
+	this->flowFields	= NULL;
+	this->goal			= -1;
+	this->goalWeight	= 0.0f;
+	this->group			= NULL;
+	this->slot			= 0;
+	this->index			= -1;
+	this->handle		= HANDLE_NONE;
+	this->script		= NULL;
+	this->localDensity	= 0.0f;
+	this->thinkSlot		= (Thinking != NULL) ? Thinking->assignSlot() : 0;
+	this->profile		= (unsigned char)profile;
+	this->random		= RandomStream(Seed, Spawned++);
+
+	// reset all boid state, then put the token into the proximity database just once, where the boid's to start (rather than at a random
+	// position, only to move it)
+	this->resetMotion();
+	this->moveTo((position != NULL) ? *position : (random.inUnitSphere() * 20));
 }
 
 Boid::~Boid()
 {
+	// (however the boid goes, its script mustn't be left to steer it)
+	if (script != NULL)
+		script->getRunner()->cancel(this);
+
+	if (group != NULL)
+		group->remove(this);
+
 	delete proximityToken;					// delete this boid's token in the proximity database
 }
 
+// A pool for each size of boid allocated, found by size (there are only ever a few); sizes beyond the first AGENT_POOLS go to the heap
+class AgentPools
+{
+	public:
+		AgentPools()
+		{
+			for (int i = 0 ; i < AGENT_POOLS ; i++)
+			{
+				sizes[i] = 0;
+				pools[i] = NULL;
+			}
+		}
+
+		~AgentPools()
+		{
+			for (int i = 0 ; i < AGENT_POOLS ; i++)
+				delete pools[i];
+		}
+
+		SlabPool* find(size_t size, bool create)
+		{
+			for (int i = 0 ; i < AGENT_POOLS ; i++)
+			{
+				if (sizes[i] == size)
+					return pools[i];
+
+				if ((sizes[i] == 0) && create)
+				{
+					sizes[i] = size;
+					pools[i] = new SlabPool(size, AGENT_SLAB);
+					return pools[i];
+				}
+			}
+
+			return NULL;
+		}
+
+		size_t reservedBytes() const
+		{
+			size_t bytes = 0;
+			for (int i = 0 ; i < AGENT_POOLS ; i++)
+				if (pools[i] != NULL)
+					bytes += pools[i]->reservedBytes();
+			return bytes;
+		}
+
+	private:
+		size_t sizes[AGENT_POOLS];
+		SlabPool* pools[AGENT_POOLS];
+};
+
+static AgentPools& Pools()
+{
+	static AgentPools pools;
+	return pools;
+}
+
+void* Boid::operator new(size_t size)
+{
+	SlabPool* pool = Pools().find(size, true);
+	return (pool != NULL) ? pool->allocate() : ::operator new(size);
+}
+
+void Boid::operator delete(void* p, size_t size)
+{
+	SlabPool* pool = Pools().find(size, false);
+
+	if (pool != NULL)
+		pool->release(p);
+	else
+		::operator delete(p);
+}
+
+size_t Boid::PoolBytes()
+{
+	return Pools().reservedBytes();
+}
+
 void Boid::reset()
 {
-	this->_lastForward			= VEC3_ZERO;
-	this->_lastPosition			= VEC3_ZERO;
+	this->resetMotion();
+	this->moveTo(random.inUnitSphere() * 20);		// randomize initial position
+}
+
+void Boid::resetMotion()
+{
 	this->_smoothedAcceleration = VEC3_ZERO;
+	this->avoidance				= VEC3_ZERO;
+	this->flowDirection			= VEC3_ZERO;
+	this->asleep				= false;
+	this->stillTicks			= 0;
 
-	this->_maxForce = 27.0f;				// steering force is clipped to this magnitude
-	this->_maxSpeed = 9.0f;
-	this->_speed	= this->_maxSpeed * 0.3f;	// initial slow speed (30% of max speed)
-	this->_radius	= 0.5f;			// size of bounding sphere
+	this->_maxForce = behaviour().MaxForce;		// steering force is clipped to this magnitude
+	this->_speed	= behaviour().MaxSpeed * 0.3f;	// initial slow speed (30% of max speed)
+	this->_radius	= behaviour().Radius;		// size of bounding sphere
 
-    this->_forward	= RandomVectorInUnitRadiusSphere().normalize();
-	this->Position	= RandomVectorInUnitRadiusSphere() * 20;	// randomize initial position
+    this->_forward	= random.inUnitSphere().normalize();
     if (RIGHT_HANDED)
         _side.cross(_forward, Vec3(0.0f, 1.0f, 0.0f));
     else
         _side.cross(Vec3(0.0f, 1.0f, 0.0f), _forward);
     this->_side = _side.normalize();
-
-	proximityToken->updateForNewPosition(Position);		// notify proximity database that our position has changed
 }
 
 void Boid::update(const float currentTime, const float elapsedTime)		// per frame simulation update
 {
-	this->applySteeringForce(steerToFlock(), elapsedTime);				// steer to flock and avoid obstacles if any
+	this->planVelocity(elapsedTime);
+	this->move(elapsedTime);
+}
+
+void Boid::planVelocity(const float elapsedTime)
+{
+	// (woken, if at all, by the plugin before planning: see BoidsPlugIn::wakeSleepers())
+	if (asleep)
+	{
+		this->plannedVelocity = VEC3_ZERO;
+		return;
+	}
+
+	// (from the profile each step, in case it's been changed)
+	this->_maxForce	= behaviour().MaxForce;
+	this->_radius	= behaviour().Radius;
+
+	this->localDensity = (Crowd != NULL) ? Crowd->density(Position) : 0.0f;
+
+	const Vec3 steering		= (group != NULL) ? steerInFormation() : steerToFlock();		// steer to flock and avoid obstacles if any
+	const Vec3 preferred	= this->steeredVelocity(steering, elapsedTime);
+
+	if ((this->_speed < SLEEP_SPEED) && (group == NULL) && (steering.lengthSquared() < (SLEEP_FORCE * SLEEP_FORCE)))
+		this->stillTicks++;
+	else
+		this->stillTicks = 0;
+
+	if (UseOrca)
+		this->plannedVelocity = ScratchArena::Local().orca.solve(*this, preferred, neighbors.begin(), neighbors.end(), behaviour().MaxSpeed, max(elapsedTime, 0.001f));
+	else
+		this->plannedVelocity = preferred;
+}
+
+void Boid::move(const float elapsedTime)
+{
+	if (asleep)
+		return;
+
+	this->applyVelocity(plannedVelocity, elapsedTime);
 
 	if (Position.x < -(LIMIT_LENGTH + 2.0f))
 		Position.x = LIMIT_LENGTH;
@@ -55,22 +211,247 @@ void Boid::update(const float currentTime, const float elapsedTime)		// per fram
 	if (Position.z > LIMIT_WIDTH + 2.0f)
 		Position.z = -LIMIT_WIDTH;
 
-	proximityToken->updateForNewPosition(Position);				// notify proximity database that our position has changed
+	if (proximityToken != NULL)
+	{
+		proximityToken->setCategory(behaviour().Category);		// (in case the profile's been changed)
+		proximityToken->updateForNewPositionAndHeading(Position, _forward);		// notify proximity database that our position has changed
+	}
+
+	if (stillTicks >= SLEEP_TICKS)
+		this->fallAsleep();
+}
+
+// Stop updating until disturbed, leaving our token where it is
+void Boid::fallAsleep()
+{
+	this->asleep				= true;
+	this->_speed				= 0.0f;
+	this->_smoothedAcceleration	= VEC3_ZERO;
+	this->plannedVelocity		= VEC3_ZERO;
+
+	neighbors.clear();
+	aggregates.clear();
+}
+
+void Boid::disturb(const AbstractVehicle& by)
+{
+	const float reach = behaviour().maxRadius() + by._radius;
+
+	if (asleep && ((by.Position - Position).lengthSquared() < (reach * reach)))
+		this->wake();
+}
+
+void Boid::wake()
+{
+	this->asleep		= false;
+	this->stillTicks	= 0;
+}
+
+void Boid::moveTo(const Vec3& position)
+{
+	this->Position = position;
+	if (proximityToken != NULL)
+	{
+		proximityToken->setCategory(behaviour().Category);		// (in case the profile's been changed)
+		proximityToken->updateForNewPositionAndHeading(Position, _forward);		// notify proximity database that our position has changed
+	}
+}
+
+void Boid::findContacts()
+{
+	// (with room for the corrections to move either of a pair a little nearer during the pass)
+	contacts.start(ScratchArena::Local().contacts);
+	if (proximityToken != NULL)
+		proximityToken->findNeighbors(this->Position, this->_radius * 3, ScratchArena::Local().contacts);
+	contacts.finish();
+}
+
+float Boid::overlapCorrection(const DistanceField& walls, Vec3& correction) const
+{
+	float deepest = 0.0f;
+	int constraints = 0;
+
+	correction = VEC3_ZERO;
+
+	// each of an overlapping pair moves half the overlap apart
+	for (AbstractVehicle* const* other = contacts.begin() ; other != contacts.end() ; other++)
+	{
+		if (*other == this)
+			continue;
+
+		const Vec3 offset		= Vec3(Position.x - (**other).Position.x, 0.0f, Position.z - (**other).Position.z);
+		const float distance	= offset.length();
+		const float overlap		= (this->_radius + (**other)._radius) - distance;
+
+		if (overlap <= 0.0f)
+			continue;
+
+		// (exactly on top of each other, split sideways)
+		const Vec3 apart = (distance > 0.0001f) ? (offset / distance) : this->_side;
+
+		correction	+= apart * (overlap * 0.5f);
+		deepest		= max(deepest, overlap);
+		constraints++;
+	}
+
+	// and out of the walls, on whichever side of them it is
+	if (walls.contains(Position))
+	{
+		const float signedDistance	= walls.distance(Position);
+		const float overlap			= this->_radius - fabs(signedDistance);
+
+		if (overlap > 0.0f)
+		{
+			correction	+= walls.gradient(Position) * (((signedDistance < 0.0f) ? -1.0f : 1.0f) * overlap);
+			deepest		= max(deepest, overlap);
+			constraints++;
+		}
+	}
+
+	// Jacobi: average the corrections rather than sum them, or a boid squeezed from all sides would overshoot; slightly over-relaxed to
+	// make up some of the pace lost
+	if (constraints > 1)
+		correction *= OVERLAP_RELAXATION / constraints;
+
+	return deepest;
+}
+
+void Boid::setProfile(int profile)
+{
+	this->profile = (unsigned char)profile;
+
+	if (proximityToken != NULL)
+	{
+		proximityToken->setCategory(behaviour().Category);
+		proximityToken->updateForNewPositionAndHeading(Position, _forward);
+	}
+}
+
+void Boid::saveState(AgentColumns& columns, int i) const
+{
+	columns.Position[i]				= Position;
+	columns.Forward[i]				= _forward;
+	columns.Side[i]					= _side;
+	columns.SmoothedAcceleration[i]	= _smoothedAcceleration;
+	columns.Avoidance[i]			= avoidance;
+	columns.FlowDirection[i]		= flowDirection;
+	columns.Speed[i]				= _speed;
+	columns.MaxForce[i]				= _maxForce;
+	columns.Radius[i]				= _radius;
+	columns.GoalWeight[i]			= goalWeight;
+	columns.Goal[i]					= goal;
+	columns.ThinkSlot[i]			= thinkSlot;
+	columns.StillTicks[i]			= stillTicks;
+	columns.InsertionOrder[i]		= (proximityToken != NULL) ? proximityToken->insertionOrder() : 0;
+	columns.Random[i]				= random;
+	columns.Profile[i]				= profile;
+	columns.Asleep[i]				= asleep ? 1 : 0;
+}
+
+void Boid::restoreState(const AgentColumns& columns, int i, int profile, int goal, FlowFieldCache* flowFields)
+{
+	this->Position				= columns.Position[i];
+	this->_forward				= columns.Forward[i];
+	this->_side					= columns.Side[i];
+	this->_smoothedAcceleration	= columns.SmoothedAcceleration[i];
+	this->avoidance				= columns.Avoidance[i];
+	this->flowDirection			= columns.FlowDirection[i];
+	this->_speed				= columns.Speed[i];
+	this->_maxForce				= columns.MaxForce[i];
+	this->_radius				= columns.Radius[i];
+	this->goalWeight			= columns.GoalWeight[i];
+	this->goal					= goal;
+	this->flowFields			= (goal >= 0) ? flowFields : NULL;
+	this->thinkSlot				= columns.ThinkSlot[i];
+	this->stillTicks			= columns.StillTicks[i];
+	this->random				= columns.Random[i];
+	this->asleep				= (columns.Asleep[i] != 0);
+
+	// a new token, added where the boid stood; in order of the saved InsertionOrder, the database is searched in the same order as it was
+	if (proximityToken != NULL)
+	{
+		delete proximityToken;
+		proximityToken = database->allocateToken(this);
+	}
+
+	this->setProfile(profile);
+}
+
+void Boid::setGoal(FlowFieldCache* flowFields, int goal, float weight)
+{
+	if ((flowFields != this->flowFields) || (goal != this->goal))
+		this->wake();
+
+	this->flowFields	= flowFields;
+	this->goal			= goal;
+	this->goalWeight	= weight;
+}
+
+void Boid::joinGroup(Group* group, int slot)
+{
+	if (proximityToken != NULL)
+	{
+		delete proximityToken;
+		proximityToken = NULL;
+	}
+
+	this->group	= group;
+	this->slot	= slot;
+	this->wake();
+}
+
+void Boid::leaveGroup()
+{
+	this->group = NULL;
+
+	if (proximityToken == NULL)
+	{
+		proximityToken = database->allocateToken(this);
+		proximityToken->setCategory(behaviour().Category);
+		proximityToken->updateForNewPositionAndHeading(Position, _forward);
+	}
 }
 
 Vec3 Boid::steerToFlock()											// basic flocking
 {
+	neighbors.clear();
+	aggregates.clear();
+
 	// avoid obstacles if needed
-	const Vec3 avoidance = obstacles->steerToAvoid(*this, 1.0f);
+	if (thinks(ThinkAvoid))
+		this->avoidance = obstacles->steerToAvoid(*this, 1.0f);
 	if (avoidance != VEC3_ZERO)
 		return avoidance;
 
-	// find all flockmates within maxRadius using proximity database
-	neighbors.clear();
-	proximityToken->findNeighbors(this->Position, maxRadius, neighbors);
+	// packed into the crowd, steer with it as a whole: down the pressure gradient & along its flow, at a cost which doesn't grow with the
+	// number of neighbors.  (Not with ORCA, which needs them individually.)
+	if ((localDensity > CROWD_PACKED) && !UseOrca)
+		return this->steerForPressure() + this->steerForCrowdAlignment() + this->steerForFlow();
+
+	// find all flockmates within the furthest force's reach using proximity database (and further, for ORCA to avoid)
+	const float maxRadius	= behaviour().maxRadius();
+	const float radius		= UseOrca ? max(maxRadius, ORCA_RADIUS) : maxRadius;
+
+	// only our own kinds of boid, other than for ORCA to avoid
+	const unsigned int categories = UseOrca ? PROXIMITY_ALL : behaviour().FlocksWith;
+
+	ScratchArena& arena = ScratchArena::Local();
+	neighbors.start(arena.neighbours);
+	aggregates.start(arena.aggregates);
 
-	// determine each of the three component behaviors of flocking
-	return this->steerForSeparation() + this->steerForAlignment() + this->steerForCohesion();
+	if (UseAggregates)		// only separation (or ORCA) needs every flockmate individually, so anything beyond its reach may come back as an aggregate
+		proximityToken->findNeighborsAggregated(this->Position, max(UseOrca ? ORCA_RADIUS : behaviour().Separation.Radius, this->_radius * 3), radius, arena.neighbours, arena.aggregates, categories);
+	else
+		proximityToken->findNeighbors(this->Position, radius, arena.neighbours, categories);
+
+	neighbors.finish();
+	aggregates.finish();
+
+	// determine each of the three component behaviors of flocking; ORCA takes the place of separation
+	if (UseOrca)
+		return this->steerForAlignment() + this->steerForCohesion() + this->steerForFlow() + this->steerForPressure();
+	else
+		return this->steerForSeparation() + this->steerForAlignment() + this->steerForCohesion() + this->steerForFlow() + this->steerForPressure();
 }
 
 void Boid::regenerateLocalSpace(const Vec3& newVelocity)	// control orientation for this boid
@@ -79,7 +460,8 @@ void Boid::regenerateLocalSpace(const Vec3& newVelocity)	// control orientation
 
 	this->_speed			= newVel.length();
 	this->Position			= Vec3(this->Position.x, 0.0f, this->Position.z);
-	this->_forward			= newVel / this->_speed;
+	if (this->_speed > 0.0f)		// (a boid brought to a standstill, e.g. by ORCA, keeps its heading)
+		this->_forward		= newVel / this->_speed;
 
     if (RIGHT_HANDED)
         _side.cross (_forward, Vec3(0.0f, 1.0f, 0.0f));
@@ -91,6 +473,8 @@ void Boid::regenerateLocalSpace(const Vec3& newVelocity)	// control orientation
 // Separation behavior: steer away from neighbors
 Vec3 Boid::steerForSeparation()
 {
+	const Force& separation = behaviour().Separation;
+
 	// Radius = Maximum Distance
 	// Angle = Cos of Maximum Angle
 
@@ -99,9 +483,9 @@ Vec3 Boid::steerForSeparation()
     int neighbors = 0;
 
     // for each of the other vehicles...
-	for (std::vector<AbstractVehicle*>::const_iterator otherVehicle = this->neighbors.begin(); otherVehicle != this->neighbors.end(); ++otherVehicle )
+	for (AbstractVehicle* const* otherVehicle = this->neighbors.begin(); otherVehicle != this->neighbors.end(); ++otherVehicle )
     {
-        if (this->inBoidNeighborhood(**otherVehicle, this->_radius * 3, Separation->Radius,	Separation->Angle))
+        if (this->inBoidNeighborhood(**otherVehicle, this->_radius * 3, separation.Radius,	separation.Angle))
         {
             // add in steering contribution
             // (opposite of the offset direction, divided once by distance
@@ -115,12 +499,14 @@ Vec3 Boid::steerForSeparation()
         }
     }
     
-    return steering.normalize() * Separation->Weight;
+    return steering.normalize() * separation.Weight;
 }
 
 // Alignment behavior: steer to head in same direction as neighbors
 Vec3 Boid::steerForAlignment()
 {
+	const Force& alignment = behaviour().Alignment;
+
 	// Radius = Maximum Distance
 	// Angle = Cos of Maximum Angle
 
@@ -129,9 +515,9 @@ Vec3 Boid::steerForAlignment()
     int neighbors = 0;
 
     // for each of the other vehicles...
-    for (std::vector<AbstractVehicle*>::const_iterator otherVehicle = this->neighbors.begin(); otherVehicle != this->neighbors.end(); otherVehicle++)
+    for (AbstractVehicle* const* otherVehicle = this->neighbors.begin(); otherVehicle != this->neighbors.end(); otherVehicle++)
     {
-        if (this->inBoidNeighborhood(**otherVehicle, this->_radius * 3, Alignment->Radius, Alignment->Angle))
+        if (this->inBoidNeighborhood(**otherVehicle, this->_radius * 3, alignment.Radius, alignment.Angle))
         {
             // accumulate sum of neighbor's heading
             steering += (**otherVehicle)._forward;
@@ -141,16 +527,28 @@ Vec3 Boid::steerForAlignment()
         }
     }
 
+    // ...and for each distant group of them, their combined heading
+    for (const ProximityAggregate* group = this->aggregates.begin(); group != this->aggregates.end(); group++)
+    {
+        if (this->inAggregateNeighborhood(*group, alignment.Radius, alignment.Angle))
+        {
+            steering += group->forwardSum;
+            neighbors += group->count;
+        }
+    }
+
     // divide by neighbors, subtract off current heading to get error-
     // correcting direction, then normalize to pure direction
     if (neighbors > 0) steering = ((steering / (float)neighbors) - _forward).normalize();
 
-    return steering * Alignment->Weight;
+    return steering * alignment.Weight;
 }
 
 // Cohesion behavior: to to move toward center of neighbors
 Vec3 Boid::steerForCohesion()
 {
+	const Force& cohesion = behaviour().Cohesion;
+
 	// Radius = Maximum Distance
 	// Angle = Cos of Maximum Angle
 
@@ -159,9 +557,9 @@ Vec3 Boid::steerForCohesion()
     int neighbors = 0;
 
     // for each of the other vehicles...
-    for (std::vector<AbstractVehicle*>::const_iterator otherVehicle = this->neighbors.begin(); otherVehicle != this->neighbors.end(); otherVehicle++)
+    for (AbstractVehicle* const* otherVehicle = this->neighbors.begin(); otherVehicle != this->neighbors.end(); otherVehicle++)
     {
-        if (this->inBoidNeighborhood(**otherVehicle, this->_radius * 3, Cohesion->Radius, Cohesion->Angle))
+        if (this->inBoidNeighborhood(**otherVehicle, this->_radius * 3, cohesion.Radius, cohesion.Angle))
         {
             // accumulate sum of neighbor's positions
             steering += (**otherVehicle).Position;
@@ -171,11 +569,105 @@ Vec3 Boid::steerForCohesion()
         }
     }
 
+    // ...and for each distant group of them, their combined positions
+    for (const ProximityAggregate* group = this->aggregates.begin(); group != this->aggregates.end(); group++)
+    {
+        if (this->inAggregateNeighborhood(*group, cohesion.Radius, cohesion.Angle))
+        {
+            steering += group->positionSum;
+            neighbors += group->count;
+        }
+    }
+
     // divide by neighbors, subtract off current position to get error-
     // correcting direction, then normalize to pure direction
     if (neighbors > 0) steering = ((steering / (float)neighbors) - Position).normalize();
 
-    return steering * Cohesion->Weight;
+    return steering * cohesion.Weight;
+}
+
+// Flow behavior: steer towards the velocity the goal's flow field asks for here
+Vec3 Boid::steerForFlow()
+{
+    if ((flowFields == NULL) || (goal < 0))
+        return VEC3_ZERO;
+
+    if (thinks(ThinkFlow))
+        this->flowDirection = flowFields->direction(goal, Position);
+    if (flowDirection == VEC3_ZERO)		// field not built yet, at the goal, or it can't be reached from here
+        return VEC3_ZERO;
+
+    return ((flowDirection * behaviour().MaxSpeed) - (_forward * _speed)).normalize() * goalWeight;
+}
+
+// Pressure behavior: steer down the crowd's pressure gradient, as strongly as separation at its steepest
+Vec3 Boid::steerForPressure()
+{
+    if (Crowd == NULL)
+        return VEC3_ZERO;
+
+    return (Crowd->pressureGradient(Position) * -1.0f).truncateLength(1.0f) * behaviour().Separation.Weight;
+}
+
+// Alignment behavior, as steerForAlignment but heading with the crowd grid's average velocity about us
+Vec3 Boid::steerForCrowdAlignment()
+{
+    const Vec3 flow = Crowd->velocity(Position);
+
+    if (flow == VEC3_ZERO)
+        return VEC3_ZERO;
+
+    return (flow.normalize() - _forward).normalize() * behaviour().Alignment.Weight;
+}
+
+// A group member steers only to its slot and clear of the rest of its group (and the walls); everyone else sees the group as one, and steers
+// round it
+Vec3 Boid::steerInFormation()
+{
+    neighbors.clear();
+    aggregates.clear();
+
+    if (thinks(ThinkAvoid))
+        this->avoidance = obstacles->steerToAvoid(*this, 1.0f);
+    if (avoidance != VEC3_ZERO)
+        return avoidance;
+
+    return this->steerToSlot() + this->steerForGroupSeparation();
+}
+
+// Formation behavior: match the group's velocity, plus enough to close the gap to our slot
+Vec3 Boid::steerToSlot()
+{
+    const Vec3 desired = group->velocity() + ((group->slotPosition(slot) - Position) * FORMATION_GAIN);
+
+    return (desired - (_forward * _speed)).truncateLength(_maxForce);
+}
+
+// Separation behavior, as steerForSeparation but from the other members of our group, who aren't in the proximity database to be found.
+// Only from those nearer than their slots are apart, so it doesn't fight steerToSlot once the formation is made.
+Vec3 Boid::steerForGroupSeparation()
+{
+    Vec3 steering;
+    const float reach = min(this->_radius * 3, FORMATION_SPACING * 0.9f);
+
+    for (std::vector<Boid*>::const_iterator other = group->getMembers().begin(); other != group->getMembers().end(); other++)
+    {
+        if (*other == this)
+            continue;
+
+        const Vec3 offset = (**other).Position - Position;
+        const float distanceSquared = offset.dot(offset);
+
+        if ((distanceSquared > 0.0f) && (distanceSquared < (reach * reach)))
+            steering += (offset / -distanceSquared);
+    }
+
+    return steering.normalize() * behaviour().Separation.Weight;
+}
+
+bool Boid::thinks(int behaviour) const
+{
+    return (Thinking == NULL) || (behaviour < 0) || Thinking->due(behaviour, thinkSlot);
 }
 
 // used by boid behaviors: is a given vehicle within this boid's neighborhood?
@@ -203,13 +695,34 @@ bool Boid::inBoidNeighborhood(const AbstractVehicle& otherVehicle, const float m
     }
 }
 
+// used by alignment & cohesion: is a group of vehicles, taken at its centre of mass, within this boid's neighborhood?
+bool Boid::inAggregateNeighborhood(const ProximityAggregate& aggregate, const float maxDistance, const float cosMaxAngle)
+{
+    const Vec3 offset = (aggregate.positionSum / (float)aggregate.count) - Position;
+    const float distanceSquared = offset.lengthSquared();
+
+    if (distanceSquared > (maxDistance * maxDistance))
+        return false;
+
+    // test angular offset from forward axis
+    const Vec3 unitOffset = offset / sqrt (distanceSquared);
+    const float forwardness = _forward.dot (unitOffset);
+    return forwardness > cosMaxAngle;
+}
+
 // ----------------------------------------------------------------------------
 // apply a given steering force to our momentum,
 // adjusting our orientation to maintain velocity-alignment.
 
 void Boid::applySteeringForce(const Vec3& force, const float elapsedTime)
 {
-    const Vec3 adjustedForce = adjustRawSteeringForce (force, elapsedTime);
+    this->applyVelocity(this->steeredVelocity(force, elapsedTime), elapsedTime);
+}
+
+OpenSteer::Vec3 Boid::steeredVelocity(const Vec3& force, const float elapsedTime)
+{
+    // (not in formation, where sidestepping into a slot at walking pace is the point)
+    const Vec3 adjustedForce = (group != NULL) ? force : adjustRawSteeringForce (force, elapsedTime);
 
     // enforce limit on magnitude of steering force
     const Vec3 clippedForce = adjustedForce.truncateLength(this->_maxForce);
@@ -229,9 +742,15 @@ void Boid::applySteeringForce(const Vec3& force, const float elapsedTime)
     // Euler integrate (per frame) acceleration into velocity
     newVelocity += _smoothedAcceleration * elapsedTime;
 
-    // enforce speed limit
-    newVelocity = newVelocity.truncateLength(this->_maxSpeed);
+    // enforce speed limit, lower in a dense crowd
+    if (Crowd != NULL)
+        return newVelocity.truncateLength(behaviour().MaxSpeed * CrowdGrid::speedFactor(localDensity));
+    else
+        return newVelocity.truncateLength(behaviour().MaxSpeed);
+}
 
+void Boid::applyVelocity(const Vec3& newVelocity, const float elapsedTime)
+{
     // update Speed
 	this->_speed = newVelocity.length();
 
@@ -241,22 +760,11 @@ void Boid::applySteeringForce(const Vec3& force, const float elapsedTime)
     // regenerate local space (by default: align vehicle's forward axis with
     // new velocity, but this behavior may be overridden by derived classes.)
     regenerateLocalSpace (newVelocity);
-
-    // maintain path curvature information
-    if (elapsedTime > 0)
-    {
-        const Vec3 dP = _lastPosition - Position;
-        const Vec3 dF = (_lastForward - _forward) / dP.length ();
-        const Vec3 lateral = dF.perpendicularComponent(_forward);
-        const float sign = (lateral.dot (_side) < 0) ? 1.0f : -1.0f;
-        _lastForward	= _forward;
-        _lastPosition	= Position;
-    }
 }
 
 OpenSteer::Vec3 Boid::adjustRawSteeringForce (const Vec3& force, const float /* deltaTime */)
 {
-    const float maxAdjustedSpeed = 0.2f * this->_maxSpeed;
+    const float maxAdjustedSpeed = 0.2f * behaviour().MaxSpeed;
 
     if ((this->_speed > maxAdjustedSpeed) || (force == VEC3_ZERO))
         return force;
@@ -1,49 +1,434 @@
+#include <cstdio>
+#include <sstream>
 #include "OpenSteer/Boids.h"
 
 BoidsPlugIn::BoidsPlugIn()
 {
+	this->EnforceRadius	= true;
+	this->UseScripts	= false;
+	this->Awake			= 0;
+	this->Asleep		= 0;
+	this->profileCheck	= 0.0f;
+	this->Deterministic	= false;
+	this->stepBacklog	= 0.0f;
+	this->pd			= NULL;
+	this->rewinding		= false;
+
+	Boid::Profiles		= &profiles;
+
+	// decisions made every few frames rather than every one, declared with how many frames apart
+	Boid::Thinking		= &thinking;
+	Boid::ThinkAvoid	= thinking.addBehaviour("Obstacle look-ahead", 2);
+	Boid::ThinkFlow		= thinking.addBehaviour("Flow field lookup", 4);
 }
 
 BoidsPlugIn::~BoidsPlugIn()
 {
+	Boid::Profiles = NULL;
+	Boid::Thinking = NULL;
 }
 
 void BoidsPlugIn::open()
 {
-	#ifdef LQ_BIN_LATTICE
-		const Vec3 center;
-		const float div = 10.0f;
-		const Vec3 divisions(div, 1, div);
-		const Vec3 dimensions(	LIMIT_LENGTH * 1.1f * 2, 
-								2.2f,
-								LIMIT_WIDTH * 1.1f * 2);
-		pd = new LQProximityDatabase<AbstractVehicle*>(center, dimensions, divisions);
-	#else
-		pd = new BruteForceProximityDatabase<AbstractVehicle*>();
-	#endif
+	const float div = 10.0f;
+	this->databaseCenter		= Vec3();
+	this->databaseDivisions		= Vec3(div, 1, div);
+	this->databaseDimensions	= Vec3(	LIMIT_LENGTH * 1.1f * 2, 
+										2.2f,
+										LIMIT_WIDTH * 1.1f * 2);
+	this->openDatabase();
 
 	// set up obstacles
 	initObstacles();
 
+	profiles.load(BEHAVIOUR_PROFILES);		// (if there's no file, every boid keeps the default profile)
+
+	crowd = new CrowdGrid(Vec3(), Vec3(LIMIT_LENGTH * 1.25f * 2, 2.2f, LIMIT_WIDTH * 1.25f * 2), 1.0f);
+	Boid::Crowd = crowd;
+
+	// places in the venue for the scripts to send boids to
+	bar			= flowFields->addGoal(Vec3(-LIMIT_LENGTH * 0.75f, 0.0f, -LIMIT_WIDTH * 0.7f));
+	danceFloor	= flowFields->addGoal(Vec3(LIMIT_LENGTH * 0.4f, 0.0f, LIMIT_WIDTH * 0.3f));
+
+	scripts = new ScriptRunner(flowFields);
+
 //	for (int i = 0 ; i < NUM_BOIDS ; i++)
 //		addBoidToFlock();
 }
 
+void BoidsPlugIn::openDatabase()
+{
+	delete pd;
+
+	#ifdef LQ_BIN_LATTICE
+		pd = new LQProximityDatabase<AbstractVehicle*>(databaseCenter, databaseDimensions, databaseDivisions);
+	#else
+		pd = new BruteForceProximityDatabase<AbstractVehicle*>();
+	#endif
+}
+
 void BoidsPlugIn::update(const float elapsedTime)
 {
+	if (!Deterministic)
+	{
+		this->step(elapsedTime);
+		return;
+	}
+
+	// in fixed steps, however long the frame took; a frame too long to catch up with in a few steps is let go
+	this->stepBacklog = min(stepBacklog + elapsedTime, DETERMINISTIC_STEP * DETERMINISTIC_MAX_STEPS);
+
+	while (stepBacklog >= DETERMINISTIC_STEP)
+	{
+		this->step(DETERMINISTIC_STEP);
+		this->stepBacklog -= DETERMINISTIC_STEP;
+	}
+}
+
+void BoidsPlugIn::seed(unsigned int seed)
+{
+	Boid::Seed		= seed;
+	Boid::Spawned	= 0;
+
+	this->random		= RandomStream(seed, SEED_PLUGIN_STREAM);
+	this->stepBacklog	= 0.0f;
+	thinking.restart();
+}
+
+// A hash of every boid's position, heading & speed, bit for bit, to compare runs by
+unsigned int BoidsPlugIn::checksum() const
+{
+	unsigned int hash = 2166136261u;		// FNV-1a
+
+	for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+	{
+		const float state[7] = {(**i).Position.x, (**i).Position.y, (**i).Position.z, (**i)._forward.x, (**i)._forward.y, (**i)._forward.z, (**i)._speed};
+		const unsigned char* bytes = (const unsigned char*)state;
+
+		for (int b = 0 ; b < (int)sizeof(state) ; b++)
+			hash = (hash ^ bytes[b]) * 16777619u;
+	}
+
+	return hash;
+}
+
+void BoidsPlugIn::step(const float elapsedTime)
+{
+	flowFields->update(Deterministic);		// pick up any flow fields finished since the last frame (or, deterministically, build them now)
+	thinking.tick();
+	scripts->update(elapsedTime);
+
+	// pick up any changes to the profiles about once a second; boids read theirs afresh each step.  (Not when deterministic, as the replay
+	// couldn't.)
+	this->profileCheck += elapsedTime;
+	if ((profileCheck >= 1.0f) && !Deterministic)
+	{
+		profiles.reload();
+		this->profileCheck = 0.0f;
+	}
+
+	// groups move first, so their members steer for where their slots are this frame; any whose members have all gone are dropped
+	for (std::vector<Group*>::iterator i = groups.begin() ; i != groups.end() ; )
+	{
+		if ((**i).getMembers().empty())
+		{
+			delete *i;
+			i = groups.erase(i);
+		}
+		else
+		{
+			(**i).update(elapsedTime);
+			i++;
+		}
+	}
+
+	this->stepFlock(elapsedTime);
+
+	// (neither, while stepping on from a keyframe to where a rewind's going: those steps are recorded & held already)
+	if (recorder.recording() && !rewinding)
+		this->recordFrame();
+
+	if (rewinder.enabled() && !rewinding)
+	{
+		if (Deterministic && this->rewindable())
+			this->rewindFrame();
+		else if (rewinder.ticks() > 0)
+			rewinder.clear();
+	}
+}
+
+void BoidsPlugIn::stepFlock(const float elapsedTime)
+{
+	ScratchArena::NextFrame();		// (last frame's neighbours & contacts are done with)
+	this->sortByProfile();
+
+	crowd->clear();
+	ParallelFor((int)flock.size(), SplatBoids, this);
+
+	this->wakeSleepers();
+
+	if (Boid::UseOrca || Deterministic)
+	{
+		// every boid's velocity is solved for from the others' current ones, so they can all be solved in parallel before any of them move
+		// (and the result doesn't depend on the order they're solved in)
+		this->stepTime = elapsedTime;
+		ParallelFor((int)planOrder.size(), PlanVelocities, this);
+
+		for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+			(**i).move(elapsedTime);
+	}
+	else
+	{
+		for (std::vector<Boid*>::const_iterator i = planOrder.begin() ; i != planOrder.end() ; i++)
+			(**i).update(NULL, elapsedTime);
+	}
+
+	if (EnforceRadius)
+		this->resolveOverlaps();
+
+	// (those still asleep, and any of the rest that have fallen asleep)
+	this->Asleep = (int)sleepers.size();
+	for (std::vector<Boid*>::const_iterator i = planOrder.begin() ; i != planOrder.end() ; i++)
+		if ((**i).isAsleep())
+			this->Asleep++;
+	this->Awake = (int)flock.size() - this->Asleep;
+}
+
+// Nothing in the steering stops boids being pushed into each other where the crowd is dense, so afterwards any that overlap are moved apart
+// (and out of the walls) directly.  Each iteration finds every boid's correction from the current positions before applying any (Jacobi),
+// so both halves run in parallel, and iterations carry on until the deepest overlap is within tolerance.
+void BoidsPlugIn::resolveOverlaps()
+{
+	overlapTimer.Start();
+
+	const int count = (int)flock.size();
+
+	corrections.resize(count);
+	overlaps.resize(count);
+
+	ParallelFor(count, FindContacts, this);
+
+	Overlaps.iterations		= 0;
+	Overlaps.initialOverlap	= 0.0f;
+	Overlaps.finalOverlap	= 0.0f;
+
+	for (int iteration = 0 ; iteration <= OVERLAP_ITERATIONS ; iteration++)
+	{
+		ParallelFor(count, FindCorrections, this);
+
+		float deepest = 0.0f;
+		for (int i = 0 ; i < count ; i++)
+			deepest = max(deepest, overlaps[i]);
+
+		if (iteration == 0)
+			Overlaps.initialOverlap = deepest;
+		Overlaps.finalOverlap = deepest;
+
+		if ((deepest <= OVERLAP_TOLERANCE) || (iteration == OVERLAP_ITERATIONS))
+			break;
+
+		ParallelFor(count, ApplyCorrections, this);
+		Overlaps.iterations++;
+	}
+
+	// let the proximity database know where everyone ended up
+	if (Overlaps.iterations > 0)
+	{
+		for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+			(**i).moveTo((**i).Position);
+	}
+
+	Overlaps.seconds = (float)overlapTimer.Stop();
+}
+
+void BoidsPlugIn::FindContacts(int begin, int end, void* plugIn)
+{
+	BoidsPlugIn* bp = (BoidsPlugIn*)plugIn;
+
+	for (int i = begin ; i < end ; i++)
+		bp->flock[i]->findContacts();
+}
+
+void BoidsPlugIn::FindCorrections(int begin, int end, void* plugIn)
+{
+	BoidsPlugIn* bp = (BoidsPlugIn*)plugIn;
+
+	for (int i = begin ; i < end ; i++)
+		bp->overlaps[i] = bp->flock[i]->overlapCorrection(*bp->obstacles, bp->corrections[i]);
+}
+
+void BoidsPlugIn::ApplyCorrections(int begin, int end, void* plugIn)
+{
+	BoidsPlugIn* bp = (BoidsPlugIn*)plugIn;
+
+	for (int i = begin ; i < end ; i++)
+		bp->flock[i]->Position += bp->corrections[i];
+}
+
+void BoidsPlugIn::SplatBoids(int begin, int end, void* plugIn)
+{
+	BoidsPlugIn* bp = (BoidsPlugIn*)plugIn;
+
+	for (int i = begin ; i < end ; i++)
+		bp->crowd->splat(*bp->flock[i]);
+}
+
+void BoidsPlugIn::PlanVelocities(int begin, int end, void* plugIn)
+{
+	BoidsPlugIn* bp = (BoidsPlugIn*)plugIn;
+
+	for (int i = begin ; i < end ; i++)
+		bp->planOrder[i]->planVelocity(bp->stepTime);
+}
+
+// A counting sort by profile index, which keeps the flock's order within each profile
+void BoidsPlugIn::sortByProfile()
+{
+	int* start = (int*)ScratchArena::Local().allocate(sizeof(int) * (profiles.count() + 1));
+	std::fill(start, start + profiles.count() + 1, 0);
+
+	sleepers.clear();
+	for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+	{
+		if ((**i).isAsleep())
+		{
+			const Sleeper sleeper = {*i, (**i).Position};
+			sleepers.push_back(sleeper);
+		}
+		else
+			start[(**i).getProfile() + 1]++;
+	}
+	for (int p = 1 ; p <= profiles.count() ; p++)
+		start[p] += start[p - 1];
+
+	planOrder.resize(flock.size() - sleepers.size());
+	for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+		if (!(**i).isAsleep())
+			planOrder[start[(**i).getProfile()]++] = *i;
+}
+
+// A sleeper costs a lookup of the crowd grid a step, rather than a query of the proximity database: the grid's velocity where it stands is
+// the average of the boids about it (itself included, still), so it wakes as a mover comes within a cell or so, or the crowd there starts
+// to flow.  (A group, wider than any one boid, disturbs those it passes itself, and a new goal wakes a boid directly.)  Woken boids plan
+// after the rest, whatever their profile.
+void BoidsPlugIn::wakeSleepers()
+{
+	size_t kept = 0;
+
+	for (size_t s = 0 ; s < sleepers.size() ; s++)
+	{
+		if (crowd->velocity(sleepers[s].Position).lengthSquared() >= (SLEEP_SPEED * SLEEP_SPEED))
+		{
+			sleepers[s].Sleeping->wake();
+			planOrder.push_back(sleepers[s].Sleeping);
+		}
+		else
+			sleepers[kept++] = sleepers[s];
+	}
+
+	sleepers.resize(kept);
+}
+
+bool BoidsPlugIn::startRecording(const char* filename)
+{
+	return recorder.open(filename);
+}
+
+void BoidsPlugIn::stopRecording()
+{
+	recorder.close();
+}
+
+void BoidsPlugIn::recordFrame()
+{
+	recorder.beginFrame();
+	for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+		recorder.add((**i).getHandle(), (**i).Position, (**i)._forward);
+	recorder.endFrame();
+}
+
+void BoidsPlugIn::configureRewind(size_t bytes, int keyframeTicks)
+{
+	rewinder.configure(bytes, keyframeTicks);
+
+	if (bytes == 0)
+		std::vector<char>().swap(keyframeImage);
+}
+
+void BoidsPlugIn::rewindFrame()
+{
+	rewinder.beginTick();
 	for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
-		(**i).update(NULL, elapsedTime);
+		rewinder.add((**i).getHandle(), (**i).Position, (**i)._forward);
+
+	if (rewinder.keyframeDue())
+	{
+		this->saveImage(keyframeImage);
+		rewinder.endTick(&keyframeImage);
+	}
+	else
+		rewinder.endTick(NULL);
+}
+
+int BoidsPlugIn::rewind(int steps)
+{
+	// (restoring a keyframe would take away every group & script, and the steps after it would go differently without them)
+	if ((rewinder.ticks() == 0) || !this->rewindable())
+		return 0;
+
+	const int last		= rewinder.lastTick();
+	const int target	= max(rewinder.firstTick(), last - max(0, steps));
+
+	const char* image;
+	size_t bytes;
+	int keyTick;
+	Checkpoint checkpoint;
+
+	if (!rewinder.keyframe(target, image, bytes, keyTick) || !checkpoint.bind(image, bytes))
+		return 0;
+
+	this->restoreImage(checkpoint);
+
+	this->rewinding = true;
+	for (int t = keyTick ; t < target ; t++)
+		this->step(DETERMINISTIC_STEP);
+	this->rewinding = false;
+
+	rewinder.truncate(target);
+	return last - target;
 }
 
 void BoidsPlugIn::close()
 {
+	recorder.close();
+
+	// break up the groups, putting their members back in the proximity database before it goes
+	for (std::vector<Group*>::const_iterator i = groups.begin() ; i != groups.end() ; i++)
+		delete *i;
+	groups.clear();
+
 	// delete each member of the flock
-	for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
-		removeBoidFromFlock();
+	this->despawn(std::vector<Boid*>(flock.begin(), flock.end()));
 
 	// delete the proximity database
 	delete pd;
 	pd = NULL;
+
+	delete scripts;
+	scripts = NULL;
+
+	Boid::Crowd = NULL;
+	delete crowd;
+	crowd = NULL;
+
+	delete flowFields;
+	flowFields = NULL;
+
+	delete obstacles;
+	obstacles = NULL;
+
+	delete walls;
+	walls = NULL;
 }
 
 void BoidsPlugIn::reset()
@@ -53,25 +438,934 @@ void BoidsPlugIn::reset()
 		(**i).reset();
 }
 
-void BoidsPlugIn::addBoidToFlock()
+void BoidsPlugIn::spawn(int count, const SpawnDistribution* where, std::vector<AgentHandle>* spawned)
 {
-	Presence* boid = new Presence(*pd, insideBigBox);
-	flock.push_back(boid);
+	std::vector<Vec3> positions;
+	if (where != NULL)
+	{
+		where->place(count, random, positions);
+		SpawnDistribution::SortByCell(positions);
+	}
+
+	if (flock.capacity() < flock.size() + count)
+		flock.reserve(max(flock.size() + count, flock.capacity() * 2));		// (not just enough, or adding one at a time would be quadratic)
+
+	for (int i = 0 ; i < count ; i++)
+	{
+		// (made with its profile & where it's to go, so its token goes into the proximity database just once)
+		const int profile = profiles.pick(random.unit());
+		Presence* boid = new Presence(*pd, obstacles, profile, (where != NULL) ? &positions[i] : NULL);
+
+		// (no more than there are handles for)
+		const AgentHandle handle = handles.add(boid);
+		if (handle == HANDLE_NONE)
+		{
+			delete boid;
+			break;
+		}
+
+		boid->setIndex((int)flock.size());
+		boid->setHandle(handle);
+		flock.push_back(boid);
+
+		if (spawned != NULL)
+			spawned->push_back(boid->getHandle());
+
+		if (UseScripts)
+			scripts->start(new NightOut(bar, danceFloor), boid);
+	}
 }
 
-void BoidsPlugIn::removeBoidFromFlock()
+void BoidsPlugIn::despawn(const std::vector<Boid*>& boids)
 {
-	if (flock.size() > 0)
+	for (std::vector<Boid*>::const_iterator i = boids.begin() ; i != boids.end() ; i++)
 	{
-		// save a pointer to the last boid, then remove it from the flock
-		const Boid* boid = flock.back();
+		Boid* boid = *i;
+
+		// swap & pop, so the flock stays packed
+		Presence* last = flock.back();
+		last->setIndex(boid->getIndex());
+		flock[boid->getIndex()] = last;
 		flock.pop_back();
 
-		delete boid;	// delete the Boid
+		handles.remove(boid->getHandle());
+		delete boid;		// cancelling its script, leaving its group & the proximity database, and going back to its pool
+	}
+
+	planOrder.clear();		// (until the next step sorts the flock again)
+}
+
+void BoidsPlugIn::despawn(const std::vector<AgentHandle>& boids)
+{
+	std::vector<Boid*> live;
+	live.reserve(boids.size());
+
+	// (each found is made stale at once, so a repeat isn't found again)
+	for (std::vector<AgentHandle>::const_iterator i = boids.begin() ; i != boids.end() ; i++)
+	{
+		Boid* boid = handles.find(*i);
+
+		if (boid != NULL)
+		{
+			handles.remove(*i);
+			live.push_back(boid);
+		}
+	}
+
+	this->despawn(live);
+}
+
+bool BoidsPlugIn::saveCheckpoint(const char* filename) const
+{
+	std::vector<char> image;
+	this->saveImage(image);
+
+	return Checkpoint::Write(filename, image);
+}
+
+void BoidsPlugIn::saveImage(std::vector<char>& image) const
+{
+	const unsigned int agents = (unsigned int)flock.size();
+	const unsigned int saved = (unsigned int)profiles.count();
+
+	image.assign(Checkpoint::Bytes(agents, saved), 0);
+
+	CHECKPOINT_HEADER& header = *(CHECKPOINT_HEADER*)&image[0];
+	memcpy(header.Magic, "OVCK", 4);
+	header.Version		= CHECKPOINT_VERSION;
+	header.Agents		= agents;
+	header.Profiles		= saved;
+	header.Seed			= Boid::Seed;
+	header.Spawned		= Boid::Spawned;
+	header.Random		= random;
+	header.ThinkFrame	= thinking.currentFrame();
+	header.ThinkSlot	= thinking.slotsAssigned();
+	header.StepBacklog	= stepBacklog;
+	header.Center		= databaseCenter;
+	header.Dimensions	= databaseDimensions;
+	header.Divisions	= databaseDivisions;
+
+	CHECKPOINT_PROFILE* records = (CHECKPOINT_PROFILE*)&image[Checkpoint::ProfilesOffset()];
+	for (unsigned int p = 0 ; p < saved ; p++)
+		Checkpoint::SaveProfile(profiles.get(p), records[p]);
+
+	AgentColumns columns;
+	columns.bind(&image[Checkpoint::AgentsOffset(saved)], agents);
+
+	pd->orderInsertions();
+	for (unsigned int i = 0 ; i < agents ; i++)
+		flock[i]->saveState(columns, i);
+}
+
+void BoidsPlugIn::prewarm(float seconds)
+{
+	// (deterministic, so that the same seed always warms up to the same crowd, and its cache can stand in for it)
+	const bool deterministic = Deterministic;
+	this->Deterministic = true;
+
+	const int steps = (int)ceil(seconds / DETERMINISTIC_STEP);
+	for (int s = 0 ; s < steps ; s++)
+		this->step(DETERMINISTIC_STEP);
+
+	this->Deterministic = deterministic;
+}
+
+std::string BoidsPlugIn::prewarmCache(const char* scenario, unsigned int seed, int count, float seconds) const
+{
+	// anything the crowd would warm up differently with: how many & for how long, the options the boids steer by, their profiles and the walls
+	unsigned int hash = 2166136261u;		// FNV-1a
+	std::vector<unsigned char> settings;
+
+	const int options[5] = {count, (int)ceil(seconds / DETERMINISTIC_STEP), Boid::UseOrca ? 1 : 0, Boid::UseAggregates ? 1 : 0, EnforceRadius ? 1 : 0};
+	settings.insert(settings.end(), (const unsigned char*)options, (const unsigned char*)(options + 5));
+
+	for (int p = 0 ; p < profiles.count() ; p++)
+	{
+		CHECKPOINT_PROFILE saved;
+		memset(&saved, 0, sizeof(saved));
+		Checkpoint::SaveProfile(profiles.get(p), saved);
+		settings.insert(settings.end(), (const unsigned char*)&saved, (const unsigned char*)(&saved + 1));
+	}
+
+	// (the venue's walls are whatever its wall file held when it was loaded, so go by them rather than by the file's name)
+	for (int w = 0 ; (walls != NULL) && (w < walls->wallCount()) ; w++)
+	{
+		const float ends[6] = {walls->wall(w).Start.x, walls->wall(w).Start.y, walls->wall(w).Start.z, walls->wall(w).End.x, walls->wall(w).End.y, walls->wall(w).End.z};
+		settings.insert(settings.end(), (const unsigned char*)ends, (const unsigned char*)(ends + 6));
+	}
+
+	for (size_t b = 0 ; b < settings.size() ; b++)
+		hash = (hash ^ settings[b]) * 16777619u;
+
+	char filename[MAX_PATH];
+	sprintf_s(filename, sizeof(filename), PREWARM_CACHE, scenario, seed, hash);
+
+	return filename;
+}
+
+// agents by their saved InsertionOrder
+class InsertionOrder
+{
+	public:
+		InsertionOrder(const int* orders) : orders(orders) {}
+		bool operator()(int a, int b) const		{ return orders[a] < orders[b]; }
+
+	private:
+		const int* orders;
+};
+
+bool BoidsPlugIn::restoreCheckpoint(const char* filename)
+{
+	Checkpoint checkpoint;
+	if (!checkpoint.map(filename))
+		return false;
+
+	this->restoreImage(checkpoint);
+	return true;
+}
+
+void BoidsPlugIn::restoreImage(const Checkpoint& checkpoint)
+{
+	const CHECKPOINT_HEADER& header = checkpoint.header();
+
+	// the crowd there was goes first, groups & all, and the database with it
+	for (std::vector<Group*>::const_iterator i = groups.begin() ; i != groups.end() ; i++)
+		delete *i;
+	groups.clear();
+	this->despawn(std::vector<Boid*>(flock.begin(), flock.end()));
+
+	this->databaseCenter		= header.Center;
+	this->databaseDimensions	= header.Dimensions;
+	this->databaseDivisions		= header.Divisions;
+	this->openDatabase();
+
+	// the checkpoint's profiles, by name, into this run's table (the boids' indices are mapped to wherever they landed)
+	int indices[MAX_PROFILES];
+	for (unsigned int p = 0 ; p < header.Profiles ; p++)
+		indices[p] = max(0, profiles.add(Checkpoint::LoadProfile(checkpoint.profiles()[p])));
+
+	const AgentColumns& columns = checkpoint.columns();
+	flock.reserve(header.Agents);
+
+	// each boid's goal, or none if the checkpoint's isn't one of this run's (a stale or damaged file), before any boid's made to follow it
+	std::vector<int> goals(header.Agents);
+	for (unsigned int i = 0 ; i < header.Agents ; i++)
+		goals[i] = ((columns.Goal[i] >= 0) && (columns.Goal[i] < flowFields->goalCount())) ? columns.Goal[i] : -1;
+
+	for (unsigned int i = 0 ; i < header.Agents ; i++)
+	{
+		Presence* boid = new Presence(*pd, obstacles);
+		boid->setIndex((int)flock.size());
+		boid->setHandle(handles.add(boid));
+		flock.push_back(boid);
+
+		_ASSERTE(boid->getHandle() != HANDLE_NONE);		// (Checkpoint::bind() takes no more agents than there are handles for)
+	}
+
+	// back into the database in the order they were found in, so the crowd carries on exactly as it would have
+	std::vector<int> order(header.Agents);
+	for (unsigned int i = 0 ; i < header.Agents ; i++)
+		order[i] = (int)i;
+	std::stable_sort(order.begin(), order.end(), InsertionOrder(columns.InsertionOrder));
+
+	for (std::vector<int>::const_iterator i = order.begin() ; i != order.end() ; i++)
+	{
+		const unsigned char profile = columns.Profile[*i];
+		flock[*i]->restoreState(columns, *i, (profile < header.Profiles) ? indices[profile] : 0, goals[*i], flowFields);
+	}
+
+	Boid::Seed			= header.Seed;
+	Boid::Spawned		= header.Spawned;
+	this->random		= header.Random;
+	this->stepBacklog	= header.StepBacklog;
+	thinking.resume(header.ThinkFrame, header.ThinkSlot);
+}
+
+void BoidsPlugIn::formGroup(int size)
+{
+	std::vector<Boid*> members;
+	for (groupType::reverse_iterator i = flock.rbegin() ; (i != flock.rend()) && ((int)members.size() < size) ; i++)
+		if ((**i).getGroup() == NULL)
+			members.push_back(*i);
+
+	if (members.size() < 2)
+		return;
+
+	// round and round the venue
+	std::vector<Vec3> path;
+	path.push_back(Vec3(-LIMIT_LENGTH * 0.6f, 0.0f, -LIMIT_WIDTH * 0.6f));
+	path.push_back(Vec3(LIMIT_LENGTH * 0.6f, 0.0f, -LIMIT_WIDTH * 0.6f));
+	path.push_back(Vec3(LIMIT_LENGTH * 0.6f, 0.0f, LIMIT_WIDTH * 0.6f));
+	path.push_back(Vec3(-LIMIT_LENGTH * 0.6f, 0.0f, LIMIT_WIDTH * 0.6f));
+
+	Group* group = new Group(*pd, path, 1.4f);		// at a stroll
+	for (std::vector<Boid*>::const_iterator i = members.begin() ; i != members.end() ; i++)
+		group->add(*i);
+
+	groups.push_back(group);
+}
+
+NightOut::NightOut(int bar, int danceFloor)
+{
+	this->bar			= bar;
+	this->danceFloor	= danceFloor;
+}
+
+void NightOut::resume()
+{
+	SCRIPT_BEGIN
+
+	while (true)
+	{
+		SCRIPT_WALK_TO(bar);
+		SCRIPT_WAIT(30.0f);
+
+		SCRIPT_WALK_TO(danceFloor);
+		SCRIPT_WAIT(60.0f + (agent->randomStream().unit() * 120.0f));
 	}
+
+	SCRIPT_END
+}
+
+Loiter::Loiter()
+{
+}
+
+void Loiter::resume()
+{
+	SCRIPT_BEGIN
+
+	while (true)
+		SCRIPT_WAIT(5.0f + (agent->randomStream().unit() * 55.0f));
+
+	SCRIPT_END
 }
 
 void BoidsPlugIn::initObstacles()
 {
-	insideBigBox = new BoxObstacle(LIMIT_LENGTH * 2, LIMIT_WIDTH * 2);
+	const Vec3 center;
+	const float div = 16.0f;
+	const Vec3 divisions(div, 1, div);
+	const Vec3 dimensions(	LIMIT_LENGTH * 1.25f * 2, 
+							2.2f,
+							LIMIT_WIDTH * 1.25f * 2);
+	walls = new ObstacleGrid(center, dimensions, divisions, 1.0f);
+
+	walls->addBox(center, LIMIT_LENGTH * 2, LIMIT_WIDTH * 2);		// the area the crowd is kept within
+
+	// the venue's own walls, as sliced from its mesh by the Testbed
+	std::vector<WallSegment> venue;
+	if (LoadWallFile(VENUE_WALLS, VENUE_WALL_HEIGHT, venue))
+	{
+		for (std::vector<WallSegment>::const_iterator i = venue.begin() ; i != venue.end() ; i++)
+			walls->addWall(i->Start, i->End);
+	}
+
+	obstacles = new DistanceField(*walls, center, dimensions, 0.25f);
+
+	flowFields = new FlowFieldCache(*obstacles, center, dimensions, 0.5f, 0.5f);
+}
+
+// Timings for the crowd's subsystems, run against the current flock and written to the given log.  
+void BoidsPlugIn::benchmark(Benchmark& results)
+{
+	const int repeats = 100;
+	Vec3 steering;				// accumulated so the work can't be optimised away
+
+	if (flock.empty())
+		return;
+
+	const double perAgent = 1.0e9 / (repeats * flock.size());		// seconds for all repeats -> nanoseconds per agent
+
+	results.Section("Obstacle avoidance");
+
+	obstacles->bake();
+	results.Report("Distance field bake", obstacles->bakeSeconds * 1000.0, "ms");
+	results.Report("Distance field memory", obstacles->memoryBytes() / 1024.0, "KB");
+	results.Report("Walls", walls->wallCount(), "");
+
+	results.Start();
+	for (int r = 0 ; r < repeats ; r++)
+		for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+			steering += walls->steerToAvoid(**i, 1.0f);
+	results.Report("Exact path test per agent", results.Stop() * perAgent, "ns");
+
+	results.Start();
+	for (int r = 0 ; r < repeats ; r++)
+		for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+			steering += obstacles->steerToAvoid(**i, 1.0f);
+	results.Report("Distance field per agent", results.Stop() * perAgent, "ns");
+
+	results.Report("(checksum)", steering.length(), "");
+
+	results.Section("Think scheduling (agents deciding per frame)");
+
+	for (int b = 0 ; b < thinking.behaviourCount() ; b++)
+		results.Report(thinking.behaviourName(b), (double)flock.size() / thinking.behaviourPeriod(b), "");
+
+	results.Section("Behaviour profiles");
+
+	results.Report("Profiles", profiles.count(), "");
+	results.Report("Boid", (double)sizeof(Boid), "bytes");
+
+	results.Start();
+	for (int r = 0 ; r < repeats ; r++)
+		this->sortByProfile();
+	results.Report("Sort by profile per agent", results.Stop() * perAgent, "ns");
+
+	results.Section("Proximity categories");
+
+	{
+		// queries about each boid for everyone, then for its own population only; a probe token which is never placed does the asking
+		ProximityToken* probe = pd->allocateToken(NULL);
+		std::vector<AbstractVehicle*> found;
+		size_t everyone = 0, own = 0;
+
+		results.Start();
+		for (int r = 0 ; r < repeats ; r++)
+			for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+			{
+				found.clear();
+				probe->findNeighbors((**i).Position, 3.0f, found);
+				everyone += found.size();
+			}
+		results.Report("All categories per query", results.Stop() * perAgent, "ns");
+
+		results.Start();
+		for (int r = 0 ; r < repeats ; r++)
+			for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+			{
+				found.clear();
+				probe->findNeighbors((**i).Position, 3.0f, found, 1u << (**i).behaviour().Category);
+				own += found.size();
+			}
+		results.Report("Own category per query", results.Stop() * perAgent, "ns");
+
+		results.Report("Found, all categories", (double)everyone / ((double)repeats * flock.size()), "");
+		results.Report("Found, own category", (double)own / ((double)repeats * flock.size()), "");
+
+		delete probe;
+	}
+
+	results.Section("Crowd grid");
+
+	results.Start();
+	for (int r = 0 ; r < repeats ; r++)
+	{
+		crowd->clear();
+		ParallelFor((int)flock.size(), SplatBoids, this);
+	}
+	results.Report("Splat per agent", results.Stop() * perAgent, "ns");
+
+	results.Start();
+	for (int r = 0 ; r < repeats ; r++)
+		for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+			steering += crowd->pressureGradient((**i).Position) + crowd->velocity((**i).Position);
+	results.Report("Pressure & velocity lookup per agent", results.Stop() * perAgent, "ns");
+	results.Report("(checksum)", steering.length(), "");
+
+	results.Section("Scripts");
+
+	{
+		// a crowd's worth of scripts doing nothing but waiting, to show what a suspended script costs a frame
+		const int count = 100000;
+		const int frames = 600;
+
+		// all following a stand-in, so none of the flock's own scripts are disturbed
+		const unsigned int spawned = Boid::Spawned;
+		Presence standIn(*pd, obstacles);
+		Boid::Spawned = spawned;
+
+		ScriptRunner idle(flowFields);
+		for (int i = 0 ; i < count ; i++)
+			idle.start(new Loiter(), &standIn);
+
+		int resumes = 0;
+
+		results.Start();
+		for (int f = 0 ; f < frames ; f++)
+		{
+			idle.update(1.0f / 60.0f);
+			resumes += idle.resumedCount();
+		}
+		results.Report("Per suspended script per frame", results.Stop() * 1.0e9 / ((double)count * frames), "ns");
+		results.Report("Resumed per frame", (double)resumes / frames, "");
+		results.Report("Arena", Script::ArenaBytes() / 1024.0, "KB");
+	}
+
+	results.Section("Non-penetration");
+
+	this->resolveOverlaps();
+	results.Report("Iterations", Overlaps.iterations, "");
+	results.Report("Deepest overlap before", Overlaps.initialOverlap, "m");
+	results.Report("Deepest overlap after", Overlaps.finalOverlap, "m");
+	results.Report("Pass", Overlaps.seconds * 1000.0, "ms");
+
+	this->benchmarkOrca(results);
+	this->benchmarkDeterminism(results);
+	this->benchmarkSpawning(results);
+	this->benchmarkCheckpoint(results);
+	this->benchmarkRecording(results);
+	this->benchmarkRewind(results);
+	this->benchmarkAllocations(results);
+}
+
+// Whole steps of the simulation, once warmed up, watched for going to the heap; there should be none.  (This moves the crowd on.)
+void BoidsPlugIn::benchmarkAllocations(Benchmark& results)
+{
+	const int steps = 120;
+
+	results.Section("Heap allocations");
+
+	if (!AllocationWatch::Counting())
+	{
+		results.Report("(counted in debug builds only)", 0, "");
+		return;
+	}
+
+	for (int s = 0 ; s < STEADY_FRAMES ; s++)
+		this->step(DETERMINISTIC_STEP);
+
+	AllocationWatch watch;
+	for (int s = 0 ; s < steps ; s++)
+		this->step(DETERMINISTIC_STEP);
+
+	results.Report("Per step, warmed up", (double)watch.count() / steps, "");
+	results.Report("None", (watch.count() == 0) ? 1 : 0, "");
+	_ASSERTE(watch.count() == 0);
+}
+
+// A seeded crowd of so many over a square at about the venue's density, in a proximity database and script runner of its own, standing in
+// for the flock (and its groups) while a benchmark runs; everything it changes is put back as it was once it goes out of scope.  It's stepped
+// deterministically, and without scripts (which a checkpoint or rewind doesn't bring back).
+class BoidsPlugIn::StandInCrowd
+{
+	public:
+		StandInCrowd(BoidsPlugIn& plugIn, int agents)
+		: plugIn(plugIn), deterministic(plugIn.Deterministic), useScripts(plugIn.UseScripts), seed(Boid::Seed), spawned(Boid::Spawned),
+		  stream(plugIn.random), schedule(plugIn.thinking), backlog(plugIn.stepBacklog), center(plugIn.databaseCenter),
+		  dimensions(plugIn.databaseDimensions), divisions(plugIn.databaseDivisions), database(plugIn.pd), scripts(plugIn.scripts)
+		{
+			const float side = sqrt((float)agents) * 1.5f;
+
+			flock.swap(plugIn.flock);
+			groups.swap(plugIn.groups);
+
+			plugIn.pd					= NULL;
+			plugIn.databaseCenter		= Vec3();
+			plugIn.databaseDimensions	= Vec3(side, 2.2f, side);
+			plugIn.databaseDivisions	= Vec3(side / 3.0f, 1.0f, side / 3.0f);
+			plugIn.openDatabase();
+
+			plugIn.scripts		= new ScriptRunner(plugIn.flowFields);
+			plugIn.UseScripts	= false;
+
+			plugIn.Deterministic = true;
+			plugIn.seed(12345);
+			const UniformSpawn square(Vec3(), side * 0.5f, side * 0.5f);
+			plugIn.spawn(agents, &square);
+		}
+
+		~StandInCrowd()
+		{
+			plugIn.despawn(std::vector<Boid*>(plugIn.flock.begin(), plugIn.flock.end()));
+			delete plugIn.pd;
+			delete plugIn.scripts;
+
+			plugIn.pd					= database;
+			plugIn.scripts				= scripts;
+			plugIn.databaseCenter		= center;
+			plugIn.databaseDimensions	= dimensions;
+			plugIn.databaseDivisions	= divisions;
+			plugIn.flock.swap(flock);
+			plugIn.groups.swap(groups);
+			plugIn.sortByProfile();
+
+			plugIn.Deterministic	= deterministic;
+			plugIn.UseScripts		= useScripts;
+			Boid::Seed				= seed;
+			Boid::Spawned			= spawned;
+			plugIn.random			= stream;
+			plugIn.stepBacklog		= backlog;
+			plugIn.thinking			= schedule;
+		}
+
+	private:
+		BoidsPlugIn& plugIn;
+
+		const bool deterministic, useScripts;
+		const unsigned int seed, spawned;
+		const RandomStream stream;
+		const ThinkScheduler schedule;
+		const float backlog;
+		const Vec3 center, dimensions, divisions;
+		ProximityDatabase* const database;
+		ScriptRunner* const scripts;
+
+		groupType flock;
+		std::vector<Group*> groups;
+};
+
+// A crowd of 100,000 standing in for the flock, saved to a checkpoint and stepped on; then restored from the checkpoint and stepped on
+// again, which should end bit for bit the same
+void BoidsPlugIn::benchmarkCheckpoint(Benchmark& results)
+{
+	const int agents = 100000;
+	const int steps = 3;
+
+	results.Section("Checkpoints");
+	const StandInCrowd standIn(*this, agents);
+
+	unsigned int checksums[2];
+
+	results.Start();
+	const bool saved = this->saveCheckpoint(CHECKPOINT_BENCHMARK);
+	results.Report("Save 100,000", results.Stop() * 1000.0, "ms");
+	results.Report("File", Checkpoint::Bytes(agents, profiles.count()) / (1024.0 * 1024.0), "MB");
+
+	for (int s = 0 ; s < steps ; s++)
+		this->stepFlock(DETERMINISTIC_STEP);
+	checksums[0] = this->checksum();
+
+	results.Start();
+	const bool restored = saved && this->restoreCheckpoint(CHECKPOINT_BENCHMARK);
+	results.Report("Restore 100,000", results.Stop() * 1000.0, "ms");
+
+	for (int s = 0 ; s < steps ; s++)
+		this->stepFlock(DETERMINISTIC_STEP);
+	checksums[1] = this->checksum();
+
+	results.Report("Identical after restoring", (restored && (checksums[0] == checksums[1])) ? 1 : 0, "");
+	remove(CHECKPOINT_BENCHMARK);
+}
+
+// A crowd of 5,000 standing in for the flock, recorded for four seconds of deterministic steps; then read back, at random and in order, with
+// the last frame checked against where the crowd ended up
+void BoidsPlugIn::benchmarkRecording(Benchmark& results)
+{
+	const int agents = 5000;
+	const int steps = 240;
+	const int seeks = 100;
+
+	results.Section("Trajectory recording");
+	const StandInCrowd standIn(*this, agents);
+
+	// a recorder of its own, so that one the user started carries on unaffected
+	TrajectoryRecorder benchmark;
+	const bool opened = benchmark.open(TRAJECTORY_BENCHMARK);
+
+	for (int s = 0 ; opened && (s < steps) ; s++)
+	{
+		this->stepFlock(DETERMINISTIC_STEP);
+
+		benchmark.beginFrame();
+		for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+			benchmark.add((**i).getHandle(), (**i).Position, (**i)._forward);
+		benchmark.endFrame();
+	}
+	benchmark.close();
+
+	results.Report("Encode 5,000, per frame", benchmark.encodeSeconds() * 1000.0 / steps, "ms");
+	results.Report("Per agent per frame", (double)benchmark.bytes() / ((double)agents * steps), "bytes");
+	results.Report("Uncompressed", (double)(sizeof(Vec3) * 2), "bytes");
+
+	TrajectoryReader reader;
+	std::vector<TrajectorySample> samples;
+	const bool readable = opened && reader.open(TRAJECTORY_BENCHMARK) && (reader.frames() == steps);
+
+	if (readable)
+	{
+		RandomStream seeking(12345, SEED_PLUGIN_STREAM);
+
+		results.Start();
+		for (int s = 0 ; s < seeks ; s++)
+			reader.read((int)(seeking.next() % steps), samples);
+		results.Report("Seek to a random frame", results.Stop() * 1000.0 / seeks, "ms");
+
+		results.Start();
+		for (int f = 0 ; f < steps ; f++)
+			reader.read(f, samples);
+		results.Report("Read in order, per frame", results.Stop() * 1000.0 / steps, "ms");
+	}
+
+	// the last frame read should be the flock, each within half a step of where it is
+	float worst = 0.0f;
+	bool matched = readable && (samples.size() == flock.size());
+	for (size_t i = 0 ; matched && (i < samples.size()) ; i++)
+	{
+		matched = (samples[i].Handle == flock[i]->getHandle());
+		worst = max(worst, (samples[i].Position - flock[i]->Position).length());
+	}
+	results.Report("Largest position error", worst * 1000.0, "mm");
+	results.Report("Matches the crowd", (matched && (worst <= TRAJECTORY_POSITION_STEP)) ? 1 : 0, "");
+
+	reader.close();
+	remove(TRAJECTORY_BENCHMARK);
+}
+
+// A crowd of 5,000 standing in for the flock, stepped on for five seconds with every step kept to rewind (and its checksum noted); then
+// rewound, a step and then a few seconds, each of which should come back to the very crowd there was, and stepped on again, which should
+// go the same way as before.  (Anything the rewind buffer held beforehand is forgotten.)
+void BoidsPlugIn::benchmarkRewind(Benchmark& results)
+{
+	const int agents = 5000;
+	const int steps = 300;
+	const int back = 150;
+	const int onward = 30;
+
+	const size_t rewindSize		= rewinder.bytes();
+	const int rewindKeyframes	= rewinder.keyframeTicks();
+
+	results.Section("Rewinding");
+	const StandInCrowd standIn(*this, agents);
+
+	this->configureRewind(REWIND_BYTES, REWIND_KEYFRAME);
+
+	// each step kept by hand, to time it apart from the step
+	std::vector<unsigned int> checksums;
+	double keeping = 0.0;
+
+	this->rewinding = true;
+	for (int s = 0 ; s < steps ; s++)
+	{
+		this->step(DETERMINISTIC_STEP);
+
+		results.Start();
+		this->rewindFrame();
+		keeping += results.Stop();
+
+		checksums.push_back(this->checksum());
+	}
+	this->rewinding = false;
+
+	results.Report("Keep a step of 5,000", keeping * 1000.0 / steps, "ms");
+	results.Report("Keyframe", Checkpoint::Bytes(agents, profiles.count()) / 1024.0, "KB");
+	results.Report("Steps held", rewinder.ticks(), "");
+	results.Report("Held per step", (double)rewinder.usedBytes() / max(1, rewinder.ticks()) / 1024.0, "KB");
+	results.Report("Ring used", rewinder.usedBytes() / (1024.0 * 1024.0), "MB");
+	results.Report("Reserved", this->rewindBytes() / (1024.0 * 1024.0), "MB");
+
+	std::vector<TrajectorySample> seen;
+	results.Start();
+	const bool viewed = rewinder.view(rewinder.lastTick() - REWIND_KEYFRAME / 2, seen);
+	results.Report("See a step, without simulating", results.Stop() * 1000.0, "ms");
+
+	// (the buffer ends where each rewind went back to)
+	results.Start();
+	bool same = viewed && (this->rewind(1) == 1);
+	results.Report("Rewind a step", results.Stop() * 1000.0, "ms");
+	same = same && (this->checksum() == checksums[rewinder.lastTick()]);
+
+	results.Start();
+	same = same && (this->rewind(back) == back);
+	results.Report("Rewind 150 steps", results.Stop() * 1000.0, "ms");
+	const int target = rewinder.lastTick();
+	same = same && (this->checksum() == checksums[target]);
+
+	for (int s = 1 ; s <= onward ; s++)
+	{
+		this->step(DETERMINISTIC_STEP);
+		same = same && (this->checksum() == checksums[target + s]);
+	}
+	results.Report("Identical after rewinding, and on", same ? 1 : 0, "");
+
+	this->configureRewind(rewindSize, rewindKeyframes);
+}
+
+// A crowd of 100,000 spawned into a database of its own, over a square at about the venue's density, then despawned by handle in two halves
+// (every other boid, then the rest) so that most of them are swapped with the last of the flock
+void BoidsPlugIn::benchmarkSpawning(Benchmark& results)
+{
+	const int agents = 100000;
+	const float side = sqrt((float)agents) * 1.5f;
+
+	const Vec3 center;
+	LQProximityDatabase<AbstractVehicle*> database(center, Vec3(side, 2.2f, side), Vec3(side / 3.0f, 1.0f, side / 3.0f));
+	const UniformSpawn square(center, side * 0.5f, side * 0.5f);
+
+	const unsigned int spawned		= Boid::Spawned;
+	const RandomStream stream		= random;
+	const ThinkScheduler schedule	= thinking;
+	ProximityDatabase* real			= pd;
+
+	groupType realFlock;
+	realFlock.swap(flock);
+	this->pd = &database;
+
+	results.Section("Spawning");
+
+	std::vector<AgentHandle> issued, scattered;
+	SlabPool& tokens = LQProximityDatabase<AbstractVehicle*>::tokenType::Pool();
+	const size_t before = Boid::PoolBytes() + tokens.reservedBytes();
+
+	results.Start();
+	this->spawn(agents, &square, &issued);
+	results.Report("Spawn 100,000", results.Stop() * 1000.0, "ms");
+	results.Report("Agent pools", Boid::PoolBytes() / 1024.0, "KB");
+	results.Report("Boid", (double)sizeof(Presence), "bytes");
+	results.Report("Per agent, with token & pool headers", (double)(Boid::PoolBytes() + tokens.reservedBytes() - before) / agents, "bytes");
+
+	for (int i = 1 ; i < agents ; i += 2)
+		scattered.push_back(issued[i]);
+
+	// the second half by every handle spawned, half of them stale by then
+	results.Start();
+	this->despawn(scattered);
+	this->despawn(issued);
+	results.Report("Despawn 100,000", results.Stop() * 1000.0, "ms");
+	results.Report("Handles left", handles.count() - (int)realFlock.size(), "");
+	results.Report("Agent pools after", Boid::PoolBytes() / 1024.0, "KB");
+	results.Report("Scratch arenas, all threads", ScratchArena::ReservedBytes() / 1024.0, "KB");
+
+	// blue noise over the same square, on one thread and then on all of them, which should place everyone the same
+	const PoissonDiskSpawn disks(center, side * 0.5f, side * 0.5f, 1.0f);
+	std::vector<Vec3> placed[2];
+
+	for (int run = 0 ; run < 2 ; run++)
+	{
+		RandomStream seeded(12345, SEED_PLUGIN_STREAM);
+		ParallelLimit((run == 0) ? 1 : 0);
+
+		results.Start();
+		disks.place(agents, seeded, placed[run]);
+		results.Report((run == 0) ? "Poisson-disk place 100,000, one thread" : "Poisson-disk place 100,000, all threads", results.Stop() * 1000.0, "ms");
+	}
+
+	ParallelLimit(0);
+	results.Report("Threads", ParallelThreads(), "");
+	results.Report("Same placement", (placed[0] == placed[1]) ? 1 : 0, "");
+
+	this->pd = real;
+	flock.swap(realFlock);
+	this->sortByProfile();
+
+	Boid::Spawned	= spawned;
+	this->random	= stream;
+	thinking		= schedule;
+}
+
+// The same seeded crowd stepped deterministically on one thread and then on all of them, which should end bit for bit the same
+void BoidsPlugIn::benchmarkDeterminism(Benchmark& results)
+{
+	const int agents = 2000;
+	const int steps = 300;
+
+	const bool deterministic		= Deterministic;
+	const unsigned int seed			= Boid::Seed;
+	const unsigned int spawned		= Boid::Spawned;
+	const ThinkScheduler schedule	= thinking;
+
+	groupType real;
+	real.swap(flock);
+
+	unsigned int checksums[2];
+
+	results.Section("Determinism");
+	this->Deterministic = true;
+
+	for (int run = 0 ; run < 2 ; run++)
+	{
+		const Vec3 center;
+		const Vec3 dimensions(LIMIT_LENGTH * 1.1f * 2, 2.2f, LIMIT_WIDTH * 1.1f * 2);
+		LQProximityDatabase<AbstractVehicle*> database(center, dimensions, Vec3(10.0f, 1.0f, 10.0f));
+
+		Boid::Seed		= 12345;
+		Boid::Spawned	= 0;
+		thinking.restart();
+
+		for (int i = 0 ; i < agents ; i++)
+			flock.push_back(new Presence(database, obstacles));
+
+		ParallelLimit((run == 0) ? 1 : 0);
+
+		results.Start();
+		for (int s = 0 ; s < steps ; s++)
+			this->stepFlock(DETERMINISTIC_STEP);
+		results.Report((run == 0) ? "One thread, per step" : "All threads, per step", results.Stop() * 1000.0 / steps, "ms");
+
+		checksums[run] = this->checksum();
+
+		for (groupType::const_iterator i = flock.begin() ; i != flock.end() ; i++)
+			delete *i;
+		flock.clear();
+	}
+
+	ParallelLimit(0);
+	results.Report("Threads", ParallelThreads(), "");
+	results.Report("Identical", (checksums[0] == checksums[1]) ? 1 : 0, "");
+
+	flock.swap(real);
+	this->sortByProfile();
+
+	this->Deterministic	= deterministic;
+	Boid::Seed			= seed;
+	Boid::Spawned		= spawned;
+	thinking			= schedule;
+}
+
+// ORCA against the separation force for crowds much larger than the venue holds, spread over a square at about the same density
+void BoidsPlugIn::benchmarkOrca(Benchmark& results)
+{
+	const int sizes[] = {10000, 25000, 50000, 100000};
+	const int runs = (int)(sizeof(sizes) / sizeof(sizes[0]));
+	const float spacing = 1.5f;			// metres between agents, on average
+
+	const bool useOrca = Boid::UseOrca;
+	groupType real;
+
+	results.Section("Reciprocal collision avoidance");
+	results.Report("Threads", ParallelThreads(), "");
+
+	for (int s = 0 ; s < runs ; s++)
+	{
+		const float side = sqrt((float)sizes[s]) * spacing;
+		const Vec3 center;
+		const Vec3 dimensions(side, 2.2f, side);
+		const Vec3 divisions(side / 3.0f, 1, side / 3.0f);		// bins the size of ORCA's reach
+
+		LQProximityDatabase<AbstractVehicle*> database(center, dimensions, divisions);
+		ObstacleGrid open(center, dimensions, Vec3(16, 1, 16), 1.0f);		// no walls, so only the avoidance between agents is timed
+
+		groupType crowd;
+		for (int i = 0 ; i < sizes[s] ; i++)
+		{
+			Presence* agent = new Presence(database, &open);
+			agent->moveTo(Vec3(F_RANDOM_01 - 0.5f, 0.0f, F_RANDOM_01 - 0.5f) * side);
+			crowd.push_back(agent);
+		}
+
+		// time planning only, over the stand-in crowd
+		real.swap(flock);
+		flock.swap(crowd);
+
+		const double perAgent = 1.0e9 / sizes[s];
+		this->stepTime = 1.0f / 60.0f;
+
+		this->sortByProfile();
+
+		Boid::UseOrca = false;
+		ScratchArena::NextFrame();
+		results.Start();
+		ParallelFor((int)planOrder.size(), PlanVelocities, this);
+		std::stringstream separation;
+		separation << sizes[s] << " agents, separation per agent";
+		results.Report(separation.str().c_str(), results.Stop() * perAgent, "ns");
+
+		Boid::UseOrca = true;
+		ScratchArena::NextFrame();
+		results.Start();
+		ParallelFor((int)planOrder.size(), PlanVelocities, this);
+		std::stringstream orca;
+		orca << sizes[s] << " agents, ORCA per agent";
+		results.Report(orca.str().c_str(), results.Stop() * perAgent, "ns");
+
+		crowd.swap(flock);
+		flock.swap(real);
+		this->sortByProfile();
+
+		for (groupType::const_iterator i = crowd.begin() ; i != crowd.end() ; i++)
+			delete *i;
+	}
+
+	Boid::UseOrca = useOrca;
 }
\ No newline at end of file
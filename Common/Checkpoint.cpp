@@ -0,0 +1,182 @@
+#include <cstring>
+#include <fstream>
+#include "OpenSteer/Checkpoint.h"
+#include "OpenSteer/Handle.h"
+
+#define CHECKPOINT_ROUND(bytes)	((((bytes) + CHECKPOINT_ALIGNMENT - 1) / CHECKPOINT_ALIGNMENT) * CHECKPOINT_ALIGNMENT)
+
+// the next array of the layout, or only its size without a base
+template <class T> static void Column(T*& array, char* base, size_t& offset, unsigned int agents)
+{
+	array	= (base != NULL) ? (T*)(base + offset) : NULL;
+	offset	+= CHECKPOINT_ROUND(sizeof(T) * agents);
+}
+
+size_t AgentColumns::bind(char* base, unsigned int agents)
+{
+	size_t offset = 0;
+
+	Column(Position, base, offset, agents);
+	Column(Forward, base, offset, agents);
+	Column(Side, base, offset, agents);
+	Column(SmoothedAcceleration, base, offset, agents);
+	Column(Avoidance, base, offset, agents);
+	Column(FlowDirection, base, offset, agents);
+	Column(Speed, base, offset, agents);
+	Column(MaxForce, base, offset, agents);
+	Column(Radius, base, offset, agents);
+	Column(GoalWeight, base, offset, agents);
+	Column(Goal, base, offset, agents);
+	Column(ThinkSlot, base, offset, agents);
+	Column(StillTicks, base, offset, agents);
+	Column(InsertionOrder, base, offset, agents);
+	Column(Random, base, offset, agents);
+	Column(Profile, base, offset, agents);
+	Column(Asleep, base, offset, agents);
+
+	return offset;
+}
+
+Checkpoint::Checkpoint()
+{
+	this->file		= INVALID_HANDLE_VALUE;
+	this->mapping	= NULL;
+	this->view		= NULL;
+
+	agents.bind(NULL, 0);
+}
+
+Checkpoint::~Checkpoint()
+{
+	this->unmap();
+}
+
+size_t Checkpoint::ProfilesOffset()
+{
+	return CHECKPOINT_ROUND(sizeof(CHECKPOINT_HEADER));
+}
+
+size_t Checkpoint::AgentsOffset(unsigned int profiles)
+{
+	return ProfilesOffset() + CHECKPOINT_ROUND(sizeof(CHECKPOINT_PROFILE) * profiles);
+}
+
+size_t Checkpoint::Bytes(unsigned int agents, unsigned int profiles)
+{
+	AgentColumns columns;
+	return AgentsOffset(profiles) + columns.bind(NULL, agents);
+}
+
+bool Checkpoint::Write(const char* filename, const std::vector<char>& image)
+{
+	std::ofstream file(filename, std::ios::out | std::ios::binary);
+	if (!file)
+		return false;
+
+	if (!image.empty())
+		file.write(&image[0], (std::streamsize)image.size());
+
+	return file.good();
+}
+
+void Checkpoint::SaveProfile(const BehaviourProfile& profile, CHECKPOINT_PROFILE& saved)
+{
+	strncpy_s(saved.Name, sizeof(saved.Name), profile.Name.c_str(), _TRUNCATE);
+
+	const Force* forces[3] = {&profile.Separation, &profile.Alignment, &profile.Cohesion};
+	float* fields[3] = {saved.Separation, saved.Alignment, saved.Cohesion};
+
+	for (int f = 0 ; f < 3 ; f++)
+	{
+		fields[f][0] = forces[f]->Radius;
+		fields[f][1] = forces[f]->Angle;
+		fields[f][2] = forces[f]->Weight;
+	}
+
+	saved.MaxSpeed		= profile.MaxSpeed;
+	saved.MaxForce		= profile.MaxForce;
+	saved.Radius		= profile.Radius;
+	saved.Share			= profile.Share;
+	saved.Category		= profile.Category;
+	saved.FlocksWith	= profile.FlocksWith;
+}
+
+BehaviourProfile Checkpoint::LoadProfile(const CHECKPOINT_PROFILE& saved)
+{
+	BehaviourProfile profile;
+
+	profile.Name		= std::string(saved.Name, strnlen(saved.Name, sizeof(saved.Name)));
+	profile.Separation	= Force(saved.Separation[0], saved.Separation[1], saved.Separation[2]);
+	profile.Alignment	= Force(saved.Alignment[0], saved.Alignment[1], saved.Alignment[2]);
+	profile.Cohesion	= Force(saved.Cohesion[0], saved.Cohesion[1], saved.Cohesion[2]);
+	profile.MaxSpeed	= saved.MaxSpeed;
+	profile.MaxForce	= saved.MaxForce;
+	profile.Radius		= saved.Radius;
+	profile.Share		= saved.Share;
+	profile.Category	= saved.Category;
+	profile.FlocksWith	= saved.FlocksWith;
+
+	return profile;
+}
+
+bool Checkpoint::map(const char* filename)
+{
+	this->unmap();
+
+	this->file = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || (size.QuadPart < (LONGLONG)sizeof(CHECKPOINT_HEADER)))
+	{
+		this->unmap();
+		return false;
+	}
+
+	const char* mapped = NULL;
+	this->mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL)
+		mapped = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (mapped == NULL)
+	{
+		this->unmap();
+		return false;
+	}
+
+	return this->bind(mapped, (size_t)size.QuadPart);
+}
+
+bool Checkpoint::bind(const char* image, size_t bytes)
+{
+	this->view = image;
+
+	// (no more agents than there are handles for, so that every one restored gets one)
+	const CHECKPOINT_HEADER& h = this->header();
+	if ((bytes < sizeof(CHECKPOINT_HEADER)) || (memcmp(h.Magic, "OVCK", 4) != 0) || (h.Version != CHECKPOINT_VERSION) || (h.Profiles == 0) ||
+		(h.Profiles > MAX_PROFILES) || (h.Agents > HANDLE_SLOTS) || (bytes != Bytes(h.Agents, h.Profiles)))
+	{
+		this->unmap();
+		return false;
+	}
+
+	agents.bind((char*)view + AgentsOffset(h.Profiles), h.Agents);
+	return true;
+}
+
+void Checkpoint::unmap()
+{
+	if ((view != NULL) && (mapping != NULL))
+		UnmapViewOfFile(view);
+	if (mapping != NULL)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+
+	this->file		= INVALID_HANDLE_VALUE;
+	this->mapping	= NULL;
+	this->view		= NULL;
+
+	agents.bind(NULL, 0);
+}
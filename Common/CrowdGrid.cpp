@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <math.h>
+#include "OpenSteer/CrowdGrid.h"
+
+#define FIXED_ONE		1024.0f			// fixed point scale of the grid's sums
+
+CrowdGrid::CrowdGrid(const Vec3& center, const Vec3& dimensions, float cellSize)
+{
+	this->origin	= center - (dimensions * 0.5f);
+	this->cellSize	= cellSize;
+	this->divx		= max(2, (int)ceil(dimensions.x / cellSize));
+	this->divz		= max(2, (int)ceil(dimensions.z / cellSize));
+
+	weights.resize(divx * divz, 0);
+	vx.resize(divx * divz, 0);
+	vz.resize(divx * divz, 0);
+}
+
+void CrowdGrid::clear()
+{
+	std::fill(weights.begin(), weights.end(), 0);
+	std::fill(vx.begin(), vx.end(), 0);
+	std::fill(vz.begin(), vz.end(), 0);
+}
+
+// find the cell whose centre is the lower corner of the four around a position, and the position's offset from it (0 to 1 on each axis)
+bool CrowdGrid::cellCoords(const Vec3& position, int& ix, int& iz, float& fx, float& fz) const
+{
+	const float u = ((position.x - origin.x) / cellSize) - 0.5f;
+	const float v = ((position.z - origin.z) / cellSize) - 0.5f;
+
+	ix = (int)floor(u);
+	iz = (int)floor(v);
+	fx = u - ix;
+	fz = v - iz;
+
+	return (ix >= -1) && (iz >= -1) && (ix < divx) && (iz < divz);
+}
+
+void CrowdGrid::splat(const AbstractVehicle& vehicle)
+{
+	int ix, iz;
+	float fx, fz;
+
+	if (!cellCoords(vehicle.Position, ix, iz, fx, fz))
+		return;
+
+	const Vec3 velocity = vehicle._forward * vehicle._speed;
+
+	for (int k = 0 ; k < 4 ; k++)
+	{
+		const int x = ix + (k & 1);
+		const int z = iz + (k >> 1);
+
+		if ((x < 0) || (z < 0) || (x >= divx) || (z >= divz))
+			continue;
+
+		const float weight	= ((k & 1) ? fx : (1.0f - fx)) * ((k >> 1) ? fz : (1.0f - fz));
+		const int cell		= (z * divx) + x;
+
+		InterlockedExchangeAdd(&weights[cell],	(LONG)(weight * FIXED_ONE));
+		InterlockedExchangeAdd(&vx[cell],		(LONG)(weight * velocity.x * FIXED_ONE));
+		InterlockedExchangeAdd(&vz[cell],		(LONG)(weight * velocity.z * FIXED_ONE));
+	}
+}
+
+float CrowdGrid::density(const Vec3& position) const
+{
+	int ix, iz;
+	float fx, fz;
+
+	if (!cellCoords(position, ix, iz, fx, fz))
+		return 0.0f;
+
+	float total = 0.0f;
+
+	for (int k = 0 ; k < 4 ; k++)
+	{
+		const int x = ix + (k & 1);
+		const int z = iz + (k >> 1);
+
+		if ((x < 0) || (z < 0) || (x >= divx) || (z >= divz))
+			continue;
+
+		total += ((k & 1) ? fx : (1.0f - fx)) * ((k >> 1) ? fz : (1.0f - fz)) * weights[(z * divx) + x];
+	}
+
+	return total / (FIXED_ONE * cellSize * cellSize);
+}
+
+OpenSteer::Vec3 CrowdGrid::velocity(const Vec3& position) const
+{
+	int ix, iz;
+	float fx, fz;
+
+	if (!cellCoords(position, ix, iz, fx, fz))
+		return VEC3_ZERO;
+
+	float weight = 0.0f;
+	Vec3 sum;
+
+	for (int k = 0 ; k < 4 ; k++)
+	{
+		const int x = ix + (k & 1);
+		const int z = iz + (k >> 1);
+
+		if ((x < 0) || (z < 0) || (x >= divx) || (z >= divz))
+			continue;
+
+		const float w	= ((k & 1) ? fx : (1.0f - fx)) * ((k >> 1) ? fz : (1.0f - fz));
+		const int cell	= (z * divx) + x;
+
+		weight	+= w * weights[cell];
+		sum		+= Vec3(w * vx[cell], 0.0f, w * vz[cell]);
+	}
+
+	return (weight > 0.0f) ? (sum / weight) : VEC3_ZERO;
+}
+
+float CrowdGrid::pressure(const Vec3& position) const
+{
+	return max(0.0f, this->density(position) - CROWD_REST_DENSITY);
+}
+
+// central differences a cell either side
+OpenSteer::Vec3 CrowdGrid::pressureGradient(const Vec3& position) const
+{
+	const float gx = this->pressure(position + Vec3(cellSize, 0.0f, 0.0f)) - this->pressure(position - Vec3(cellSize, 0.0f, 0.0f));
+	const float gz = this->pressure(position + Vec3(0.0f, 0.0f, cellSize)) - this->pressure(position - Vec3(0.0f, 0.0f, cellSize));
+
+	return Vec3(gx, 0.0f, gz) / (2.0f * cellSize);
+}
+
+// Weidmann's fundamental diagram, kept just above zero so that a jammed crowd still creeps rather than locking solid
+float CrowdGrid::speedFactor(float density)
+{
+	if (density <= 0.0f)
+		return 1.0f;
+
+	return max(0.05f, 1.0f - (float)exp(-1.913f * ((1.0f / density) - (1.0f / CROWD_JAM_DENSITY))));
+}
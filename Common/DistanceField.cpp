@@ -0,0 +1,151 @@
+#include "OpenSteer/DistanceField.h"
+#include "Benchmark.h"
+
+static inline float interpolate(float alpha, float x0, float x1)
+{
+	return x0 + ((x1 - x0) * alpha);
+}
+
+DistanceField::DistanceField(ObstacleGrid& walls, const Vec3& center, const Vec3& dimensions, float cellSize)
+: Obstacle()
+{
+	this->walls			= &walls;
+	this->Position		= center;
+	this->origin		= center - (dimensions * 0.5f);
+	this->cellSize		= cellSize;
+	this->divx			= max(2, (int)ceil(dimensions.x / cellSize));
+	this->divz			= max(2, (int)ceil(dimensions.z / cellSize));
+	this->bakeSeconds	= 0.0f;
+
+	samples.resize(divx * divz);
+
+	this->bake();
+}
+
+DistanceField::~DistanceField()
+{
+}
+
+void DistanceField::bake()
+{
+	Benchmark timer;
+	timer.Start();
+
+	// distance to the nearest wall at the centre of each cell
+	for (int iz = 0 ; iz < divz ; iz++)
+	{
+		for (int ix = 0 ; ix < divx ; ix++)
+		{
+			const Vec3 centre = origin + Vec3((ix + 0.5f) * cellSize, 0.0f, (iz + 0.5f) * cellSize);
+			samples[(iz * divx) + ix].distance = walls->signedDistance(centre);
+		}
+	}
+
+	// gradient by central differences, one-sided at the edges of the field
+	for (int iz = 0 ; iz < divz ; iz++)
+	{
+		for (int ix = 0 ; ix < divx ; ix++)
+		{
+			const int x0 = max(ix - 1, 0);
+			const int x1 = min(ix + 1, divx - 1);
+			const int z0 = max(iz - 1, 0);
+			const int z1 = min(iz + 1, divz - 1);
+
+			const float gx		= (sample(x1, iz).distance - sample(x0, iz).distance) / ((x1 - x0) * cellSize);
+			const float gz		= (sample(ix, z1).distance - sample(ix, z0).distance) / ((z1 - z0) * cellSize);
+			const float length	= sqrt((gx * gx) + (gz * gz));
+
+			Sample& s	= samples[(iz * divx) + ix];
+			s.gx		= (length > 0.0f) ? (gx / length) : 0.0f;
+			s.gz		= (length > 0.0f) ? (gz / length) : 0.0f;
+		}
+	}
+
+	this->bakeSeconds = (float)timer.Stop();
+}
+
+bool DistanceField::contains(const Vec3& point) const
+{
+	const float x = point.x - origin.x;
+	const float z = point.z - origin.z;
+
+	return (x >= 0.0f) && (z >= 0.0f) && (x < (divx * cellSize)) && (z < (divz * cellSize));
+}
+
+// find the cell whose centre is the lower corner of the four samples around a point, and the point's offset from it (0 to 1 on each axis)
+void DistanceField::cellCoords(const Vec3& point, int& ix, int& iz, float& fx, float& fz) const
+{
+	const float u = ((point.x - origin.x) / cellSize) - 0.5f;
+	const float v = ((point.z - origin.z) / cellSize) - 0.5f;
+
+	ix = max(0, min((int)floor(u), divx - 2));
+	iz = max(0, min((int)floor(v), divz - 2));
+	fx = max(0.0f, min(u - ix, 1.0f));
+	fz = max(0.0f, min(v - iz, 1.0f));
+}
+
+float DistanceField::distance(const Vec3& point) const
+{
+	int ix, iz;
+	float fx, fz;
+	cellCoords(point, ix, iz, fx, fz);
+
+	const float lower	= interpolate(fx, sample(ix, iz).distance,		sample(ix + 1, iz).distance);
+	const float upper	= interpolate(fx, sample(ix, iz + 1).distance,	sample(ix + 1, iz + 1).distance);
+	return interpolate(fz, lower, upper);
+}
+
+OpenSteer::Vec3 DistanceField::gradient(const Vec3& point) const
+{
+	int ix, iz;
+	float fx, fz;
+	cellCoords(point, ix, iz, fx, fz);
+
+	const Sample& s00 = sample(ix,		iz);
+	const Sample& s10 = sample(ix + 1,	iz);
+	const Sample& s01 = sample(ix,		iz + 1);
+	const Sample& s11 = sample(ix + 1,	iz + 1);
+
+	const float gx = interpolate(fz, interpolate(fx, s00.gx, s10.gx), interpolate(fx, s01.gx, s11.gx));
+	const float gz = interpolate(fz, interpolate(fx, s00.gz, s10.gz), interpolate(fx, s01.gz, s11.gz));
+
+	return Vec3(gx, 0.0f, gz).normalize();
+}
+
+OpenSteer::Vec3 DistanceField::steerToAvoid(const AbstractVehicle& vehicle, const float minTimeToCollision)
+{
+	if (!this->contains(vehicle.Position))
+		return walls->steerToAvoid(vehicle, minTimeToCollision);
+
+	// No wall can be met within minTimeToCollision unless one lies within that reach, plus the vehicle's radius (which walls are widened by
+	// along their length), plus a cell for the samples the filtered distance is blended from.  That rules out most vehicles with a single lookup.
+	const float signedDistance	= this->distance(vehicle.Position);
+	const float reach			= (minTimeToCollision * vehicle._speed) + vehicle._radius + cellSize;
+
+	if (fabs(signedDistance) > reach)
+		return VEC3_ZERO;
+
+	// otherwise steer away from the nearest wall, on whichever side of it the vehicle is, if heading towards it
+	const Vec3 away = this->gradient(vehicle.Position) * ((signedDistance < 0.0f) ? -1.0f : 1.0f);
+
+	if (away.dot(vehicle._forward) >= 0.0f)
+		return VEC3_ZERO;
+
+	// take the lateral component as PathIntersection does; heading straight at the wall leaves none, so turn to the side
+	const Vec3 lateral = away.perpendicularComponent(vehicle._forward);
+
+	if (lateral.lengthSquared() < 0.0001f)
+		return vehicle._side * vehicle._maxForce;
+	else
+		return lateral.normalize() * vehicle._maxForce;
+}
+
+PathIntersection DistanceField::findIntersectionWithVehiclePath(const AbstractVehicle& vehicle)
+{
+	return walls->findIntersectionWithVehiclePath(vehicle);
+}
+
+unsigned int DistanceField::memoryBytes() const
+{
+	return sizeof(DistanceField) + (unsigned int)(samples.capacity() * sizeof(Sample));
+}
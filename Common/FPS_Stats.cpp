@@ -4,7 +4,7 @@ FPS_Stats::FPS_Stats(LPDIRECT3DDEVICE9 Device)
 {
 	this->Device	= Device;
 	this->Font		= NULL;
-	this->Label		= "Getting FPS";
+	strcpy_s(this->Label, sizeof(this->Label), "Getting FPS");
 
 	this->numFrames		= 0.0f;
 	this->timeElapsed	= 0.0f;
@@ -33,8 +33,6 @@ FPS_Stats::~FPS_Stats()
 
 void FPS_Stats::Update(float dt)
 {
-	std::stringstream ss;
-
 	numFrames += 1.0f;
 	timeElapsed += dt;
 
@@ -45,14 +43,11 @@ void FPS_Stats::Update(float dt)
 		this->timeElapsed	= 0.0f;
 		this->numFrames		= 0.0f;
 
-		ss << "FPS: " << mFPS;
-
-		Label.clear();
-		Label = ss.str();
+		sprintf_s(Label, sizeof(Label), "FPS: %g", mFPS);
 	}
 }
 
 void FPS_Stats::Render()
 {
-	Font->DrawText(NULL, Label.c_str(), Label.length(), &this->Dimensions, DT_LEFT | DT_TOP, D3DCOLOR_ARGB(255, 255, 255, 255));
+	Font->DrawText(NULL, Label, -1, &this->Dimensions, DT_LEFT | DT_TOP, D3DCOLOR_ARGB(255, 255, 255, 255));
 }
\ No newline at end of file
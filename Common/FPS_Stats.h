@@ -1,8 +1,8 @@
 #ifndef _FPS_STATS_H_
 #define _FPS_STATS_H_
 
-#include <string>
-#include <sstream>
+#include <stdio.h>
+#include <string.h>
 #include <d3dx9.h>
 
 class FPS_Stats
@@ -21,7 +21,7 @@ class FPS_Stats
 		LPDIRECT3DDEVICE9 Device;
 		LPD3DXFONT Font;    // the pointer to the font object
 		RECT Dimensions;
-		std::string		Label;
+		char			Label[32];		// (rewritten each second, so kept off the heap)
 
 		float numFrames;
 		float timeElapsed;
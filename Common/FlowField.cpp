@@ -0,0 +1,461 @@
+#include <algorithm>
+#include <float.h>
+#include <functional>
+#include <process.h>
+#include "OpenSteer/FlowField.h"
+
+// The eight neighbours of a cell, ordered so that neighbour 7 - k lies in the opposite direction to neighbour k
+static const int NeighbourX[8]		= {-1,  0,  1, -1, 1, -1, 0, 1};
+static const int NeighbourZ[8]		= {-1, -1, -1,  0, 0,  1, 1, 1};
+static const float NeighbourStep[8]	= {1.4142136f, 1.0f, 1.4142136f, 1.0f, 1.0f, 1.4142136f, 1.0f, 1.4142136f};
+static const float NeighbourDirX[8]	= {-0.7071068f, 0.0f,  0.7071068f, -1.0f, 1.0f, -0.7071068f, 0.0f, 0.7071068f};
+static const float NeighbourDirZ[8]	= {-0.7071068f, -1.0f, -0.7071068f, 0.0f, 0.0f, 0.7071068f, 1.0f, 0.7071068f};
+
+typedef std::pair<float, int> OpenEntry;	// (cost, cell) on the Dijkstra frontier, a min-heap via std::greater
+
+FlowField::FlowField(int goalCell, int divx, int divz)
+{
+	this->goalCell	= goalCell;
+	this->divx		= divx;
+	this->divz		= divz;
+
+	distance.resize(divx * divz, FLT_MAX);
+	step.resize(divx * divz, -1);
+}
+
+int FlowField::neighbour(int cell, int k) const
+{
+	const int x = (cell % divx) + NeighbourX[k];
+	const int z = (cell / divx) + NeighbourZ[k];
+
+	if ((x < 0) || (z < 0) || (x >= divx) || (z >= divz))
+		return -1;
+
+	return (z * divx) + x;
+}
+
+float FlowField::edgeCost(const std::vector<float>& costs, int from, int k, float cellSize) const
+{
+	const int to = neighbour(from, k);
+
+	if ((to < 0) || (costs[to] == FLOW_BLOCKED) || (costs[from] == FLOW_BLOCKED))
+		return FLT_MAX;
+
+	// no cutting the corner of a blocked cell on a diagonal step
+	if ((NeighbourX[k] != 0) && (NeighbourZ[k] != 0))
+	{
+		const int x = from % divx;
+		const int z = from / divx;
+
+		if ((costs[(z * divx) + x + NeighbourX[k]] == FLOW_BLOCKED) || (costs[((z + NeighbourZ[k]) * divx) + x] == FLOW_BLOCKED))
+			return FLT_MAX;
+	}
+
+	return NeighbourStep[k] * cellSize * 0.5f * (costs[from] + costs[to]);
+}
+
+// Dijkstra: settle the cheapest cell on the frontier and lower any neighbour it offers a cheaper route to, until the frontier is empty
+void FlowField::relax(const std::vector<float>& costs, std::vector<OpenEntry>& open, float cellSize)
+{
+	while (!open.empty())
+	{
+		std::pop_heap(open.begin(), open.end(), std::greater<OpenEntry>());
+		const OpenEntry current = open.back();
+		open.pop_back();
+
+		if (current.first > distance[current.second])		// stale entry, the cell has been reached more cheaply since
+			continue;
+
+		for (int k = 0 ; k < 8 ; k++)
+		{
+			const float edge = edgeCost(costs, current.second, k, cellSize);
+			if (edge == FLT_MAX)
+				continue;
+
+			const int next			= neighbour(current.second, k);
+			const float candidate	= current.first + edge;
+
+			if (candidate < distance[next])
+			{
+				distance[next]	= candidate;
+				step[next]		= (char)(7 - k);				// step back the way we came
+
+				open.push_back(OpenEntry(candidate, next));
+				std::push_heap(open.begin(), open.end(), std::greater<OpenEntry>());
+			}
+		}
+	}
+}
+
+void FlowField::sweep(const std::vector<float>& costs, float cellSize)
+{
+	std::vector<OpenEntry> open;
+
+	std::fill(distance.begin(), distance.end(), FLT_MAX);
+	std::fill(step.begin(), step.end(), -1);
+
+	if ((goalCell < 0) || (costs[goalCell] == FLOW_BLOCKED))
+		return;
+
+	distance[goalCell] = 0.0f;
+	open.push_back(OpenEntry(0.0f, goalCell));
+
+	relax(costs, open, cellSize);
+}
+
+void FlowField::repair(const std::vector<float>& costs, const std::vector<int>& changed, float cellSize)
+{
+	std::vector<char> invalid(distance.size(), 0);
+	std::vector<int> found;
+	std::vector<OpenEntry> open;
+
+	// every cell whose route to the goal ran through a changed cell has to be found again: walk back up the routes from each changed cell.
+	// Its neighbours are taken too, as their diagonal steps may cut its corner.
+	for (std::vector<int>::const_iterator i = changed.begin() ; i != changed.end() ; i++)
+	{
+		for (int k = -1 ; k < 8 ; k++)
+		{
+			const int cell = (k < 0) ? *i : neighbour(*i, k);
+
+			if ((cell >= 0) && !invalid[cell])
+			{
+				invalid[cell] = 1;
+				found.push_back(cell);
+			}
+		}
+	}
+
+	for (size_t i = 0 ; i < found.size() ; i++)
+	{
+		for (int k = 0 ; k < 8 ; k++)
+		{
+			const int next = neighbour(found[i], k);
+
+			if ((next >= 0) && !invalid[next] && (step[next] == (char)(7 - k)))		// does next step onto this cell?
+			{
+				invalid[next] = 1;
+				found.push_back(next);
+			}
+		}
+	}
+
+	if ((goalCell >= 0) && invalid[goalCell])
+	{
+		sweep(costs, cellSize);
+		return;
+	}
+
+	for (std::vector<int>::const_iterator i = found.begin() ; i != found.end() ; i++)
+	{
+		distance[*i]	= FLT_MAX;
+		step[*i]		= -1;
+	}
+
+	// seed each of them from its cheapest neighbour whose route still stands, then let Dijkstra carry on from there.  Cells whose cost
+	// fell can also offer cheaper routes to cells outside the set, which the sweep lowers as it passes.
+	for (std::vector<int>::const_iterator i = found.begin() ; i != found.end() ; i++)
+	{
+		for (int k = 0 ; k < 8 ; k++)
+		{
+			const int next = neighbour(*i, k);
+
+			if ((next < 0) || invalid[next] || (distance[next] == FLT_MAX))
+				continue;
+
+			const float edge = edgeCost(costs, *i, k, cellSize);
+
+			if ((edge != FLT_MAX) && (distance[next] + edge < distance[*i]))
+			{
+				distance[*i]	= distance[next] + edge;
+				step[*i]		= (char)k;
+			}
+		}
+
+		if (distance[*i] != FLT_MAX)
+			open.push_back(OpenEntry(distance[*i], *i));
+	}
+
+	std::make_heap(open.begin(), open.end(), std::greater<OpenEntry>());
+	relax(costs, open, cellSize);
+}
+
+FlowFieldCache::FlowFieldCache(DistanceField& obstacles, const Vec3& center, const Vec3& dimensions, float cellSize, float clearance)
+{
+	this->obstacles	= &obstacles;
+	this->origin	= center - (dimensions * 0.5f);
+	this->cellSize	= cellSize;
+	this->clearance	= clearance;
+	this->divx		= max(2, (int)ceil(dimensions.x / cellSize));
+	this->divz		= max(2, (int)ceil(dimensions.z / cellSize));
+	this->quit		= false;
+
+	this->readCosts(costs);
+
+	InitializeCriticalSection(&lock);
+	this->wake		= CreateEvent(NULL, FALSE, FALSE, NULL);
+	this->thread	= (HANDLE)_beginthreadex(NULL, 0, Worker, this, 0, NULL);
+}
+
+FlowFieldCache::~FlowFieldCache()
+{
+	EnterCriticalSection(&lock);
+	this->quit = true;
+	LeaveCriticalSection(&lock);
+
+	SetEvent(wake);
+	WaitForSingleObject(thread, INFINITE);
+
+	CloseHandle(thread);
+	CloseHandle(wake);
+	DeleteCriticalSection(&lock);
+
+	for (std::deque<Job*>::iterator i = pending.begin() ; i != pending.end() ; i++)
+	{
+		delete (*i)->field;
+		delete *i;
+	}
+
+	for (std::deque<Job*>::iterator i = finished.begin() ; i != finished.end() ; i++)
+	{
+		delete (*i)->field;
+		delete *i;
+	}
+
+	for (std::vector<FlowField*>::iterator i = fields.begin() ; i != fields.end() ; i++)
+		delete *i;
+}
+
+// Traversal cost of each cell: blocked within the clearance of a wall (or outside the obstacles' field), and dearer close to one so that
+// routes keep off the walls rather than hugging them.
+void FlowFieldCache::readCosts(std::vector<float>& costs) const
+{
+	costs.resize(divx * divz);
+
+	for (int iz = 0 ; iz < divz ; iz++)
+	{
+		for (int ix = 0 ; ix < divx ; ix++)
+		{
+			const Vec3 centre = origin + Vec3((ix + 0.5f) * cellSize, 0.0f, (iz + 0.5f) * cellSize);
+
+			if (!obstacles->contains(centre) || (obstacles->distance(centre) < clearance))
+				costs[(iz * divx) + ix] = FLOW_BLOCKED;
+			else
+				costs[(iz * divx) + ix] = 1.0f + (2.0f * max(0.0f, 1.0f - (obstacles->distance(centre) / (clearance * 4.0f))));
+		}
+	}
+}
+
+int FlowFieldCache::cellFor(const Vec3& position) const
+{
+	const int ix = (int)floor((position.x - origin.x) / cellSize);
+	const int iz = (int)floor((position.z - origin.z) / cellSize);
+
+	if ((ix < 0) || (iz < 0) || (ix >= divx) || (iz >= divz))
+		return -1;
+
+	return (iz * divx) + ix;
+}
+
+int FlowFieldCache::addGoal(const Vec3& goal)
+{
+	fields.push_back(NULL);
+	goals.push_back(goal);
+	goalCells.push_back(cellFor(goal));
+	building.push_back(false);
+	swept.push_back(false);
+	dirty.push_back(std::vector<int>());
+
+	this->update();			// start building straight away
+
+	return (int)fields.size() - 1;
+}
+
+bool FlowFieldCache::ready(int goal) const
+{
+	return fields[goal] != NULL;
+}
+
+OpenSteer::Vec3 FlowFieldCache::direction(int goal, const Vec3& position) const
+{
+	const FlowField* field = fields[goal];
+
+	if (field == NULL)
+		return VEC3_ZERO;
+
+	// blend the step directions of the four cells around the position, weighted by nearness, so the flow turns smoothly between cells
+	const float u = ((position.x - origin.x) / cellSize) - 0.5f;
+	const float v = ((position.z - origin.z) / cellSize) - 0.5f;
+	const int ix = (int)floor(u);
+	const int iz = (int)floor(v);
+	const float fx = u - ix;
+	const float fz = v - iz;
+
+	Vec3 flow;
+
+	for (int k = 0 ; k < 4 ; k++)
+	{
+		const int x = ix + (k & 1);
+		const int z = iz + (k >> 1);
+
+		if ((x < 0) || (z < 0) || (x >= divx) || (z >= divz))
+			continue;
+
+		const char s = field->step[(z * divx) + x];
+		if (s < 0)
+			continue;
+
+		const float weight = ((k & 1) ? fx : (1.0f - fx)) * ((k >> 1) ? fz : (1.0f - fz));
+		flow += Vec3(NeighbourDirX[s], 0.0f, NeighbourDirZ[s]) * weight;
+	}
+
+	return flow.normalize();
+}
+
+void FlowFieldCache::obstaclesChanged()
+{
+	std::vector<float> latest;
+	this->readCosts(latest);
+
+	for (int i = 0 ; i < (int)latest.size() ; i++)
+	{
+		if (latest[i] != costs[i])
+		{
+			for (size_t g = 0 ; g < dirty.size() ; g++)
+				dirty[g].push_back(i);
+		}
+	}
+
+	costs.swap(latest);
+
+	this->update();
+}
+
+void FlowFieldCache::update(bool synchronous)
+{
+	this->publish();
+
+	// (first letting any jobs already under way on the worker finish)
+	if (synchronous)
+	{
+		while (std::find(building.begin(), building.end(), true) != building.end())
+		{
+			Sleep(1);
+			this->publish();
+		}
+	}
+
+	// start a job for each goal which has never been swept, or has changed since its last job started
+	bool started = false;
+
+	for (int g = 0 ; g < (int)fields.size() ; g++)
+	{
+		if (building[g] || (swept[g] && dirty[g].empty()))
+			continue;
+
+		Job* job	= new Job();
+		job->goal	= g;
+		job->costs	= costs;
+
+		if (!swept[g])
+		{
+			job->field	= new FlowField(goalCells[g], divx, divz);
+			swept[g]	= true;
+		}
+		else if (fields[g] == NULL)		// (changed while its first sweep was under way: sweep again)
+			job->field	= new FlowField(goalCells[g], divx, divz);
+		else
+		{
+			job->field	= new FlowField(*fields[g]);
+			job->changed.swap(dirty[g]);
+
+			std::sort(job->changed.begin(), job->changed.end());
+			job->changed.erase(std::unique(job->changed.begin(), job->changed.end()), job->changed.end());
+		}
+
+		dirty[g].clear();
+
+		if (synchronous)
+		{
+			this->build(job);
+
+			delete fields[g];
+			fields[g] = job->field;
+
+			delete job;
+			continue;
+		}
+
+		building[g] = true;
+
+		EnterCriticalSection(&lock);
+		pending.push_back(job);
+		LeaveCriticalSection(&lock);
+
+		started = true;
+	}
+
+	if (started)
+		SetEvent(wake);
+}
+
+void FlowFieldCache::publish()
+{
+	std::deque<Job*> done;
+
+	EnterCriticalSection(&lock);
+	done.swap(finished);
+	LeaveCriticalSection(&lock);
+
+	// publish whatever the worker has finished since last time
+	for (std::deque<Job*>::iterator i = done.begin() ; i != done.end() ; i++)
+	{
+		delete fields[(*i)->goal];
+		fields[(*i)->goal]		= (*i)->field;
+		building[(*i)->goal]	= false;
+
+		delete *i;
+	}
+}
+
+void FlowFieldCache::build(Job* job) const
+{
+	if (job->changed.empty())
+		job->field->sweep(job->costs, cellSize);
+	else
+		job->field->repair(job->costs, job->changed, cellSize);
+}
+
+unsigned __stdcall FlowFieldCache::Worker(void* cache)
+{
+	FlowFieldCache* ffc = (FlowFieldCache*)cache;
+
+	while (true)
+	{
+		WaitForSingleObject(ffc->wake, INFINITE);
+
+		while (true)
+		{
+			Job* job = NULL;
+
+			EnterCriticalSection(&ffc->lock);
+			if (!ffc->quit && !ffc->pending.empty())
+			{
+				job = ffc->pending.front();
+				ffc->pending.pop_front();
+			}
+			const bool quit = ffc->quit;
+			LeaveCriticalSection(&ffc->lock);
+
+			if (quit)
+				return 0;
+			if (job == NULL)
+				break;
+
+			ffc->build(job);
+
+			EnterCriticalSection(&ffc->lock);
+			ffc->finished.push_back(job);
+			LeaveCriticalSection(&ffc->lock);
+		}
+	}
+}
@@ -0,0 +1,129 @@
+#include "OpenSteer/Group.h"
+
+Group::Group(ProximityDatabase& pd, const std::vector<Vec3>& path, float speed)
+{
+	this->path			= path;
+	this->waypoint		= 0;
+	this->cruiseSpeed	= speed;
+	this->leader		= path.empty() ? VEC3_ZERO : path.front();
+
+	this->Position		= leader;
+	this->_forward		= Vec3(1.0f, 0.0f, 0.0f);
+	this->_side			= Vec3(0.0f, 0.0f, 1.0f);
+	this->_speed		= 0.0f;
+	this->_maxForce		= 0.0f;
+	this->_radius		= 0.0f;
+
+	proximityToken = pd.allocateToken(this);
+	proximityToken->updateForNewPositionAndHeading(Position, _forward);
+}
+
+Group::~Group()
+{
+	for (std::vector<Boid*>::iterator i = members.begin() ; i != members.end() ; i++)
+		(**i).leaveGroup();
+
+	delete proximityToken;
+}
+
+void Group::add(Boid* member)
+{
+	if (members.empty())		// the group sets off from where its first member stands
+		this->leader = member->Position;
+
+	members.push_back(member);
+	this->arrangeSlots();
+
+	member->joinGroup(this, (int)members.size() - 1);
+}
+
+void Group::remove(Boid* member)
+{
+	std::vector<Boid*>::iterator i = std::find(members.begin(), members.end(), member);
+	if (i == members.end())
+		return;
+
+	members.erase(i);
+	this->arrangeSlots();
+
+	for (int slot = 0 ; slot < (int)members.size() ; slot++)
+		members[slot]->joinGroup(this, slot);
+}
+
+// two abreast, rows one behind the other, with an odd one out walking alone at the back
+void Group::arrangeSlots()
+{
+	const int count = (int)members.size();
+
+	offsets.resize(count);
+	centre = VEC3_ZERO;
+
+	for (int i = 0 ; i < count ; i++)
+	{
+		const bool alone = ((i % 2) == 0) && (i == count - 1);
+		const float across = alone ? 0.0f : (((i % 2) == 0) ? -0.5f : 0.5f) * FORMATION_SPACING;
+
+		offsets[i]	= Vec3(across, 0.0f, -(i / 2) * FORMATION_SPACING);
+		centre		+= offsets[i] / (float)count;
+	}
+
+	float radius = 0.0f;
+	for (int i = 0 ; i < count ; i++)
+		radius = max(radius, (offsets[i] - centre).length() + members[i]->_radius);
+
+	this->_radius = radius;
+}
+
+OpenSteer::Vec3 Group::slotPosition(int slot) const
+{
+	return leader + (_side * offsets[slot].x) + (_forward * offsets[slot].z);
+}
+
+void Group::update(const float elapsedTime)
+{
+	if (path.empty())
+		return;
+
+	// slow down for whoever has fallen furthest behind, so the group stays together
+	float lag = 0.0f;
+	for (int i = 0 ; i < (int)members.size() ; i++)
+		lag = max(lag, (members[i]->Position - slotPosition(i)).length());
+
+	this->_speed = cruiseSpeed * max(0.2f, min(1.0f, 1.0f - (lag / FORMATION_SLACK)));
+
+	// on round the path, turning smoothly towards the next waypoint
+	Vec3 ahead = path[waypoint] - leader;
+	ahead.y = 0.0f;
+
+	if (ahead.length() < FORMATION_SPACING)
+	{
+		waypoint	= (waypoint + 1) % path.size();
+		ahead		= path[waypoint] - leader;
+		ahead.y		= 0.0f;
+	}
+
+	if (ahead != VEC3_ZERO)
+	{
+		const Vec3 turned = _forward + ((ahead.normalize() - _forward) * min(1.0f, elapsedTime * 2.0f));
+		if (turned != VEC3_ZERO)
+			this->_forward = turned.normalize();
+	}
+
+	if (RIGHT_HANDED)
+		_side.cross(_forward, Vec3(0.0f, 1.0f, 0.0f));
+	else
+		_side.cross(Vec3(0.0f, 1.0f, 0.0f), _forward);
+	this->_side = _side.normalize();
+
+	leader += _forward * (_speed * elapsedTime);
+
+	// the proxy everyone else sees covers the whole formation
+	this->Position = leader + (_side * centre.x) + (_forward * centre.z);
+	proximityToken->updateForNewPositionAndHeading(Position, _forward);
+
+	nearby.clear();
+	proximityToken->findNeighbors(Position, _radius + 1.0f, nearby);
+
+	for (std::vector<AbstractVehicle*>::const_iterator i = nearby.begin() ; i != nearby.end() ; i++)
+		(**i).disturb(*this);
+}
@@ -0,0 +1,64 @@
+#include <crtdbg.h>
+#include "OpenSteer/Handle.h"
+
+HandleTable::HandleTable()
+{
+	this->firstFree	= HANDLE_INDEX_MASK;
+	this->lastFree	= HANDLE_INDEX_MASK;
+	this->live		= 0;
+}
+
+AgentHandle HandleTable::add(Boid* agent)
+{
+	unsigned int index;
+
+	if (firstFree != HANDLE_INDEX_MASK)
+	{
+		index = firstFree;
+		this->firstFree = slots[index].next;
+		if (firstFree == HANDLE_INDEX_MASK)
+			this->lastFree = HANDLE_INDEX_MASK;
+	}
+	else
+	{
+		// (a slot past the last would be the end of the free list, or run into the generation's bits)
+		_ASSERTE(slots.size() < HANDLE_SLOTS);
+		if (slots.size() >= HANDLE_SLOTS)
+			return HANDLE_NONE;
+
+		Slot slot;
+		slot.agent		= NULL;
+		slot.generation	= 0;
+		slot.next		= HANDLE_INDEX_MASK;
+
+		index = (unsigned int)slots.size();
+		slots.push_back(slot);
+	}
+
+	Slot& slot = slots[index];
+	slot.agent		= agent;
+	slot.generation	= (slot.generation % (HANDLE_GENERATIONS - 1)) + 1;		// 1 to HANDLE_GENERATIONS - 1, round and round
+	live++;
+
+	return (slot.generation << HANDLE_INDEX_BITS) | index;
+}
+
+void HandleTable::remove(AgentHandle handle)
+{
+	if (find(handle) == NULL)
+		return;
+
+	const unsigned int index = handle & HANDLE_INDEX_MASK;
+
+	// the generation is left as it was, so the handle goes stale now, and is only moved on when the slot's reused
+	Slot& slot = slots[index];
+	slot.agent	= NULL;
+	slot.next	= HANDLE_INDEX_MASK;
+	live--;
+
+	if (lastFree != HANDLE_INDEX_MASK)
+		slots[lastFree].next = index;
+	else
+		this->firstFree = index;
+	this->lastFree = index;
+}
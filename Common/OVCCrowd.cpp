@@ -8,10 +8,18 @@ OVCCrowd::OVCCrowd(LPDIRECT3DDEVICE9 Device, LPD3DXEFFECT HLSL)
 	this->GeometryPacket	= NULL;
 	this->IndexPacket		= NULL;
 	this->CrowdInstances	= NULL;
-	this->LabelInstances	= "";
+	this->LabelInstances[0]	= '\0';
+	this->LabelSleep[0]		= '\0';
+	sprintf_s(LabelRewind, sizeof(LabelRewind), "Rewind: Off");
+	this->SteadySize		= 0;
+	this->SteadyFrames		= 0;
+	this->Replayed			= NULL;
+	this->ReplayLog			= NULL;
 	this->LabelInstancing	= "Geometric Instancing: Enabled";
 	this->LabelBoids		= "Boids Animation: Enabled";
 	this->LabelFrustum		= "Frustum Culling: Enabled";
+	this->LabelRecording	= "Recording: Off";
+	this->LabelReplay		= "Replay: Off";
 	//this->LabelAnimation	= "Skeletal Animation: Enabled";			// Disabled due to issues with skeletal animation
 
 	this->Initialise();
@@ -21,6 +29,8 @@ OVCCrowd::OVCCrowd(LPDIRECT3DDEVICE9 Device, LPD3DXEFFECT HLSL)
 	this->UseFrustum	= true;
 	this->UseAnimation	= true;
 
+	this->WasDeterministic	= Deterministic;
+
 	this->Font		= NULL;
 
 	D3DXCreateFont(	this->Device,				// the D3D Device
@@ -40,12 +50,19 @@ OVCCrowd::OVCCrowd(LPDIRECT3DDEVICE9 Device, LPD3DXEFFECT HLSL)
 	SetRect(&this->TextBoids, 0, 16, 200, 32);
 	SetRect(&this->TextFrustum, 0, 32, 200, 48);
 	SetRect(&this->TextAnimation, 0, 48, 200, 64);
+	SetRect(&this->TextRecording, 0, 64, 200, 80);
 
 	SetRect(&this->TextInstances, 0, 80, 250, 96);
+	SetRect(&this->TextSleep, 0, 96, 250, 112);
+	SetRect(&this->TextReplay, 0, 112, 250, 128);
+	SetRect(&this->TextRewind, 0, 128, 350, 144);
 }
 
 OVCCrowd::~OVCCrowd()
 {
+	if (this->Replay.replaying())
+		this->StopReplay();
+
 	this->Font		= NULL;
 
 	flock.clear();
@@ -128,7 +145,27 @@ void OVCCrowd::Initialise()
 
 	this->open();
 
-	this->AddInstances(DEFAULT_INSTANCES);
+	// Start from a settled crowd: restored from the cache if this scenario & seed have been warmed up before, otherwise spawned and stepped on
+	// headless (nothing's rendered or packed into instances yet) and cached for next time.  (Scripts aren't kept in a checkpoint, so a crowd
+	// following them is always warmed afresh.)
+	const std::string cache = this->prewarmCache(PREWARM_SCENARIO, PREWARM_SEED, DEFAULT_INSTANCES, PREWARM_SECONDS);
+
+	if (UseScripts || !this->restoreCheckpoint(cache.c_str()))
+	{
+		this->seed(PREWARM_SEED);
+		this->AddInstances(DEFAULT_INSTANCES);
+		this->prewarm(PREWARM_SECONDS);
+
+		if (!UseScripts)
+			this->saveCheckpoint(cache.c_str());
+	}
+
+	sprintf_s(LabelInstances, sizeof(LabelInstances), "Crowd Size (Visible): %d", (int)flock.size());
+
+	#ifdef BENCHMARK
+		Benchmark results("Benchmark.txt");
+		this->benchmark(results);
+	#endif
 
 	Mesh->GetVertexBuffer(&this->GeometryPacket);
 	Mesh->GetIndexBuffer(&this->IndexPacket);
@@ -136,60 +173,133 @@ void OVCCrowd::Initialise()
 
 void OVCCrowd::ReadyBatch(D3DXMATRIX &VP)
 {
-	stringstream ss;
-	bool render;
-
 	int p = 0;				// Used as a test for controlling which are uploaded for batching.  
+	int v = 0;				// culled in, whether or not there was room to pack them
 
 	INSTANCE* pInstances;
 	D3DXMATRIX World;
 
 	// Used for filtering through the members if required.  
 	CrowdInstances->Lock(0, NULL, (void**)&pInstances, 0);
-	for (MemberList = flock.begin() ; MemberList != flock.end() ; MemberList++)
+	if (this->Replayed != NULL)
 	{
-		World	= (*MemberList)->GetWorld();
-		render	= true;
+		// a recorded frame's agents in place of the flock, posed the same way.  Every one's culled, so the count seen doesn't depend on
+		// the room there is, but only as many as there's room for are packed.
+		const vector<TrajectorySample>& Agents = Replayed->Agents;
 
-		if (this->UseFrustum)
+		for (size_t a = 0 ; a < Agents.size() ; a++)
 		{
-			for (int i = 0 ; i < 6 ; i++)
+			World = Presence::Pose(Agents[a].Position, Agents[a].Forward);
+
+			if (this->Visible(World))
 			{
-				if (D3DXPlaneDotCoord(&Plane[i], &D3DXVECTOR3(World._41, World._42, World._43)) < -RADIUS)
+				v++;
+				if (p < MAX_INSTANCES)
 				{
-					render = false;
-
-					break;
+					pInstances->World = World;
+					pInstances++;
+					p++;
 				}
 			}
 		}
-
-		if (render)
+	}
+	else
+	{
+		for (MemberList = flock.begin() ; MemberList != flock.end() ; MemberList++)
 		{
-			pInstances->World = World;
-			pInstances++;
-			p++;
+			World = (*MemberList)->GetWorld();
+
+			if (this->Visible(World))
+			{
+				pInstances->World = World;
+				pInstances++;
+				p++;
+				v++;
+			}
 		}
 	}
 	CrowdInstances->Unlock();
 
-	ss << "Crowd Size (Visible): " << p;
+	sprintf_s(LabelInstances, sizeof(LabelInstances), "Crowd Size (Visible): %d", v);
+
+	this->batch_size	= p;
+	this->batch_visible	= v;
+}
 
-	LabelInstances.clear();
-	LabelInstances = ss.str();
+bool OVCCrowd::Visible(const D3DXMATRIX &World)
+{
+	if (this->UseFrustum)
+	{
+		for (int i = 0 ; i < 6 ; i++)
+		{
+			if (D3DXPlaneDotCoord(&Plane[i], &D3DXVECTOR3(World._41, World._42, World._43)) < -RADIUS)
+				return false;
+		}
+	}
 
-	this->batch_size = p;
+	return true;
 }
 
 void OVCCrowd::Update(D3DXMATRIX &VP, float dt)
 {
-	this->batch_size = 0;
+	AllocationWatch watch;
+
+	this->batch_size	= 0;
+	this->batch_visible	= 0;
+
+	// a replay stands in for the simulation, and is always batched (it's ReadyBatch that's being timed)
+	if (this->Replayed != NULL)
+	{
+		ReplayLog->Start();
+		this->ReadyBatch(VP);
+		this->ReplayBatching += ReplayLog->Stop();
+
+		this->ReplayAgents		+= Replayed->Agents.size();
+		this->ReplayVisible		+= batch_visible;
+		this->ReplayChecksum	= (ReplayChecksum ^ batch_visible) * 16777619u;
+		this->ReplayFrames++;
+
+		return;
+	}
 
 	if (UseBoids)
+	{
+		if (this->isRecording())
+			this->recordCamera((const float*)VP);
+
 		this->update(dt);
 
+		// (the file's cut short by then, so it's not kept as a recording)
+		if (this->recordingFailed())
+		{
+			this->stopRecording();
+			this->LabelRecording = "Recording: Failed";
+		}
+
+		sprintf_s(LabelSleep, sizeof(LabelSleep), "Awake / Asleep: %d / %d", this->Awake, this->Asleep);
+
+		// (with how many ticks were too big to keep at all, if any, as each lost everything held; and nothing's kept with groups or scripts)
+		if (this->rewindBuffer().enabled() && !this->rewindable())
+			sprintf_s(LabelRewind, sizeof(LabelRewind), "Rewind: Paused while groups or scripts are active");
+		else if (this->rewindBuffer().enabled() && (this->rewindBuffer().overflowed() > 0))
+			sprintf_s(LabelRewind, sizeof(LabelRewind), "Rewind: %.1f s held, %.1f of %.1f MB, %d ticks too big", this->rewindBuffer().ticks() * DETERMINISTIC_STEP,
+				this->rewindBuffer().usedBytes() / (1024.0f * 1024.0f), this->rewindBytes() / (1024.0f * 1024.0f), this->rewindBuffer().overflowed());
+		else if (this->rewindBuffer().enabled())
+			sprintf_s(LabelRewind, sizeof(LabelRewind), "Rewind: %.1f s held, %.1f of %.1f MB", this->rewindBuffer().ticks() * DETERMINISTIC_STEP,
+				this->rewindBuffer().usedBytes() / (1024.0f * 1024.0f), this->rewindBytes() / (1024.0f * 1024.0f));
+	}
+
 	if (this->UseInstancing)
 		this->ReadyBatch(VP);
+
+	// once the crowd has settled at its size, a frame shouldn't go to the heap at all (checked in debug builds)
+	if (flock.size() != SteadySize)
+	{
+		this->SteadySize	= flock.size();
+		this->SteadyFrames	= 0;
+	}
+	else if ((++this->SteadyFrames > STEADY_FRAMES) && (watch.count() > 0))
+		_RPT1(_CRT_WARN, "OVCCrowd: %ld heap allocations in a steady-state frame\n", watch.count());
 }
 
 void OVCCrowd::Render(D3DXMATRIX &VP, float TimeDelta)
@@ -214,7 +324,7 @@ void OVCCrowd::Render(D3DXMATRIX &VP, float TimeDelta)
 
 	this->Update(VP, TimeDelta * 0.5f);
 
-	if (this->UseInstancing)
+	if (this->UseInstancing || (this->Replayed != NULL))
 	{
 		if (this->batch_size != 0)
 			this->RenderInstancing(VP);
@@ -226,16 +336,18 @@ void OVCCrowd::Render(D3DXMATRIX &VP, float TimeDelta)
 	Font->DrawText(NULL, LabelBoids.c_str(),		LabelBoids.length(),		&this->TextBoids,		DT_LEFT | DT_TOP, D3DCOLOR_ARGB(255, 255, 255, 255));
 	Font->DrawText(NULL, LabelFrustum.c_str(),		LabelFrustum.length(),		&this->TextFrustum,		DT_LEFT | DT_TOP, D3DCOLOR_ARGB(255, 255, 255, 255));
 //	Font->DrawText(NULL, LabelAnimation.c_str(),	LabelAnimation.length(),	&this->TextAnimation,	DT_LEFT | DT_TOP, D3DCOLOR_ARGB(255, 255, 255, 255));
+	Font->DrawText(NULL, LabelRecording.c_str(),	LabelRecording.length(),	&this->TextRecording,	DT_LEFT | DT_TOP, D3DCOLOR_ARGB(255, 255, 255, 255));
 
-	Font->DrawText(NULL, LabelInstances.c_str(),	LabelInstances.length(),	&this->TextInstances,	DT_LEFT | DT_TOP, D3DCOLOR_ARGB(255, 255, 255, 255));
+	Font->DrawText(NULL, LabelInstances,			-1,							&this->TextInstances,	DT_LEFT | DT_TOP, D3DCOLOR_ARGB(255, 255, 255, 255));
+	Font->DrawText(NULL, LabelSleep,				-1,							&this->TextSleep,		DT_LEFT | DT_TOP, D3DCOLOR_ARGB(255, 255, 255, 255));
+	Font->DrawText(NULL, LabelReplay.c_str(),		LabelReplay.length(),		&this->TextReplay,		DT_LEFT | DT_TOP, D3DCOLOR_ARGB(255, 255, 255, 255));
+	Font->DrawText(NULL, LabelRewind,				-1,							&this->TextRewind,		DT_LEFT | DT_TOP, D3DCOLOR_ARGB(255, 255, 255, 255));
 }
 
 void OVCCrowd::RenderRegular(D3DXMATRIX &VP)
 {
-	stringstream ss;
 	D3DXMATRIX World, WIT;
 	UINT uPasses;
-	bool render;
 	UINT p = 0;
 
 	HLSL->SetTechnique("Render");
@@ -244,23 +356,9 @@ void OVCCrowd::RenderRegular(D3DXMATRIX &VP)
 
 	for (MemberList = flock.begin() ; MemberList != flock.end() ; MemberList++)
 	{
-		World	= (*MemberList)->GetWorld();
-		render	= true;
+		World = (*MemberList)->GetWorld();
 
-		if (this->UseFrustum)
-		{
-			for (int i = 0 ; i < 6 ; i++)
-			{
-				if (D3DXPlaneDotCoord(&Plane[i], &D3DXVECTOR3(World._41, World._42, World._43)) < -RADIUS)
-				{
-					render = false;
-
-					break;
-				}
-			}
-		}
-
-		if (render)
+		if (this->Visible(World))
 		{
 			HLSL->Begin(&uPasses, 0);
 			for (UINT uPass = 0 ; uPass < uPasses ; ++uPass)
@@ -287,10 +385,7 @@ void OVCCrowd::RenderRegular(D3DXMATRIX &VP)
 		}
 	}
 
-	ss << "Crowd Size (Visible): " << p;
-
-	LabelInstances.clear();
-	LabelInstances = ss.str();
+	sprintf_s(LabelInstances, sizeof(LabelInstances), "Crowd Size (Visible): %d", p);
 }
 
 void OVCCrowd::RenderInstancing(D3DXMATRIX &VP)
@@ -325,45 +420,33 @@ void OVCCrowd::RenderInstancing(D3DXMATRIX &VP)
 
 void OVCCrowd::AddInstances(int n)
 {
-	std::stringstream ss;
+	// If the number asked takes it over the instance limit, only add as far as the limit.
+	n = min(n, MAX_INSTANCES - (int)flock.size());
 
-	// If the number asked takes it over the instance limit, only add as far as the limit.  Otherwise, add as normal.  
-	if (flock.size() + n > MAX_INSTANCES)
-	{
-		for (int i = flock.size() ; i < MAX_INSTANCES ; i++)
-			flock.push_back(new Presence(*pd, this->insideBigBox));
-	}
-	else
-	{
-		for (int i = 0 ; i < n ; i++)
-			flock.push_back(new Presence(*pd, this->insideBigBox));
-	}
+	// Spread out over the venue, a body's width or more apart, clear of the walls and of those already there.
+	float radius = 0.0f;
+	for (int i = 0 ; i < profiles.count() ; i++)
+		radius = max(radius, profiles.get(i).Radius);
 
-	ss << "Crowd Size (Visible): " << flock.size();
+	std::vector<Vec3> taken;
+	taken.reserve(flock.size());
+	for (MemberList = flock.begin() ; MemberList != flock.end() ; MemberList++)
+		taken.push_back((*MemberList)->Position);
+
+	PoissonDiskSpawn venue(Vec3(0.0f, 0.0f, 0.0f), LIMIT_LENGTH, LIMIT_WIDTH, (2.0f * radius) + SPAWN_MARGIN, obstacles, radius);
+	venue.keepClearOf(&taken);
 
-	LabelInstances.clear();
-	LabelInstances = ss.str();
+	this->spawn(n, &venue);
+
+	sprintf_s(LabelInstances, sizeof(LabelInstances), "Crowd Size (Visible): %d", (int)flock.size());
 }
 
 void OVCCrowd::RemoveInstances(int n)
 {
-	std::stringstream ss;
-
-	if (flock.size() == 0)
-		return;
-
-	if ((flock.size() - n) <= 0)
-		flock.clear();
-	else
-	{
-		for (int i = 0 ; i < n ; i++)
-			flock.pop_back();
-	}
-
-	ss << "Crowd Size (Visible): " << flock.size();
+	// the last n, or as many as there are
+	this->despawn(std::vector<Boid*>(flock.end() - min(n, (int)flock.size()), flock.end()));
 
-	LabelInstances.clear();
-	LabelInstances = ss.str();
+	sprintf_s(LabelInstances, sizeof(LabelInstances), "Crowd Size (Visible): %d", (int)flock.size());
 }
 
 void OVCCrowd::SwitchInstancing()
@@ -423,6 +506,123 @@ void OVCCrowd::SwitchFrustum()
 	LabelFrustum = ss.str();
 }
 
+void OVCCrowd::SwitchRecording()
+{
+	std::stringstream ss;
+
+	if (this->isRecording())
+	{
+		this->stopRecording();
+		ss << "Recording: Off";
+	}
+	else if (this->startRecording(RECORDING_FILE))
+		ss << "Recording: " << RECORDING_FILE;
+	else
+		ss << "Recording: Failed";
+
+	LabelRecording.clear();
+	LabelRecording = ss.str();
+}
+
+void OVCCrowd::SwitchReplay()
+{
+	if (this->Replay.replaying())
+	{
+		this->StopReplay();
+		return;
+	}
+
+	std::stringstream ss;
+
+	// (not of a recording still being made)
+	if (this->isRecording())
+		this->SwitchRecording();
+
+	if (this->Replay.open(RECORDING_FILE))
+	{
+		this->ReplayLog			= new Benchmark(REPLAY_RESULTS);
+		this->ReplayBatching	= 0.0;
+		this->ReplayAgents		= 0;
+		this->ReplayVisible		= 0;
+		this->ReplayChecksum	= 2166136261u;		// FNV-1a
+		this->ReplayFrames		= 0;
+		QueryPerformanceCounter((LARGE_INTEGER*)&this->ReplayBegan);
+
+		ss << "Replay: " << RECORDING_FILE << ", " << Replay.frames() << " frames";
+	}
+	else
+		ss << "Replay: Failed";
+
+	LabelReplay.clear();
+	LabelReplay = ss.str();
+}
+
+// Keeping the last few seconds to step back through, which needs the crowd stepped deterministically while it's on
+void OVCCrowd::SwitchRewind()
+{
+	if (this->rewindBuffer().enabled())
+	{
+		this->configureRewind(0);
+		this->Deterministic = WasDeterministic;
+
+		sprintf_s(LabelRewind, sizeof(LabelRewind), "Rewind: Off");
+	}
+	else
+	{
+		this->WasDeterministic	= Deterministic;
+		this->Deterministic		= true;
+		this->configureRewind(REWIND_BYTES);
+
+		sprintf_s(LabelRewind, sizeof(LabelRewind), "Rewind: On");
+	}
+}
+
+void OVCCrowd::StepBack()
+{
+	this->rewind(REWIND_STEP_BACK);
+}
+
+void OVCCrowd::AdvanceReplay(D3DXMATRIX &VP)
+{
+	if (!this->Replay.replaying())
+		return;
+
+	this->Replayed = Replay.next();
+
+	if (this->Replayed == NULL)
+		this->StopReplay();
+	else if (Replayed->Camera)
+		VP = D3DXMATRIX(Replayed->ViewProjection);
+}
+
+// The end of a replay, finished or not, with its timings written out; everything per frame is an average over the frames replayed
+void OVCCrowd::StopReplay()
+{
+	__int64 finish, frequency;
+	QueryPerformanceCounter((LARGE_INTEGER*)&finish);
+	QueryPerformanceFrequency((LARGE_INTEGER*)&frequency);
+
+	const double frames = (ReplayFrames > 0) ? (double)ReplayFrames : 1.0;
+
+	ReplayLog->Section("Replay");
+	ReplayLog->Report("Frames", ReplayFrames, "");
+	ReplayLog->Report("Of", Replay.frames(), "");
+	ReplayLog->Report("Agents per frame", ReplayAgents / frames, "");
+	ReplayLog->Report("Visible per frame", ReplayVisible / frames, "");
+	ReplayLog->Report("Visible checksum", ReplayChecksum, "");
+	ReplayLog->Report("Frame", (double)(finish - ReplayBegan) * 1000.0 / ((double)frequency * frames), "ms");
+	ReplayLog->Report("Culling & packing per frame", ReplayBatching * 1000.0 / frames, "ms");
+	ReplayLog->Report("Waiting for decoding per frame", Replay.waitSeconds() * 1000.0 / frames, "ms");
+
+	delete ReplayLog;
+	this->ReplayLog = NULL;
+	this->Replayed	= NULL;
+	Replay.close();
+
+	LabelReplay.clear();
+	LabelReplay = "Replay: Off";
+}
+
 /*	The following function is removed due to issues with skeletal animation.  
 
 void OVCCrowd::SwitchAnimation()
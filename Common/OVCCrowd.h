@@ -2,15 +2,27 @@
 #define _OVC_CROWD_H_
 
 #include <d3dx9.h>
+#include <stdio.h>
 #include <sstream>
 #include <vector>
 #include "Presence.h"
 #include "OpenSteer/Boids.h"
+#include "Allocations.h"
 
 #include <iostream>
 #include <fstream>
 using namespace std;
 
+//#define BENCHMARK		// writes timings for the crowd's subsystems to Benchmark.txt on startup
+
+#define PREWARM_SCENARIO	"Venue"		// the crowd shown on startup, settled before the first frame...
+#define PREWARM_SEED		1			// ...from this seed...
+#define PREWARM_SECONDS		10.0f		// ...by this much crowd time
+
+#define RECORDING_FILE		"Recording.trajectory"		// where the crowd's trajectories go, while recording, and are replayed from
+#define REPLAY_RESULTS		"Replay.txt"				// timings of the last replay, written when it ends
+#define REWIND_STEP_BACK	60							// deterministic steps gone back at a time (a second)
+
 #ifdef TIGER
 	#define RADIUS 1.0f
 #else
@@ -37,6 +49,12 @@ class OVCCrowd : public BoidsPlugIn
 		void SwitchInstancing();
 		void SwitchBoids();
 		void SwitchFrustum();
+		void SwitchRecording();
+		void SwitchReplay();
+		void SwitchRewind();
+		void StepBack();
+
+		void AdvanceReplay(D3DXMATRIX &VP);		// to the next frame, once a frame while replaying, taking the recorded camera (if any) for VP
 		// void SwitchAnimation();				// Disabled due to issues with skeletal animation
 
 	private:
@@ -46,9 +64,13 @@ class OVCCrowd : public BoidsPlugIn
 		void RenderInstancing(D3DXMATRIX &VP);
 
 		void ReadyBatch(D3DXMATRIX &VP);
+		bool Visible(const D3DXMATRIX &World);
+
+		void StopReplay();
 		void LoadXFile(char* filename);
 
 		bool UseInstancing, UseBoids, UseFrustum, UseAnimation;
+		bool WasDeterministic;		// before rewind was switched on, to go back to when it's off
 
 		D3DXPLANE Plane[6];
 
@@ -65,14 +87,28 @@ class OVCCrowd : public BoidsPlugIn
 		DWORD							numMaterials;	// stores the number of materials in the mesh
 
 		LPD3DXFONT Font;    // the pointer to the font object
-		RECT TextInstances, TextInstancing, TextBoids, TextFrustum, TextAnimation;
-		string		LabelInstances, LabelInstancing, LabelBoids, LabelFrustum, LabelAnimation;
+		RECT TextInstances, TextInstancing, TextBoids, TextFrustum, TextAnimation, TextRecording, TextReplay, TextRewind, TextSleep;
+		string		LabelInstancing, LabelBoids, LabelFrustum, LabelAnimation, LabelRecording, LabelReplay;
+		char		LabelInstances[64], LabelSleep[64], LabelRewind[96];		// rewritten every frame, so kept off the heap
 
 		vector<Presence*>::iterator MemberList;
 
 		ofstream myfile;
 
 		unsigned int batch_size;
+		unsigned int batch_visible;		// culled in, of which batch_size were packed (all of them, unless a replay had more than MAX_INSTANCES)
+
+		size_t SteadySize;			// of the flock, and for how many frames
+		int SteadyFrames;
+
+		// Replaying a recording in place of the simulation, straight into ReadyBatch, with what it takes timed
+		TrajectoryReplay	Replay;
+		const ReplayFrame*	Replayed;			// this frame's, while replaying
+		Benchmark*			ReplayLog;
+		double				ReplayBatching;		// seconds spent readying batches (culling & packing), in all
+		__int64				ReplayBegan, ReplayAgents, ReplayVisible;
+		unsigned int		ReplayChecksum;		// of every frame's visible count, so runs of two builds can be seen to have culled alike
+		int					ReplayFrames;
 
 };
 
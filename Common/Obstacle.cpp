@@ -246,4 +246,248 @@ void BoxObstacle::draw()
 {
 	for (int i = 0 ; i < 4 ; i++)
 		r[i]->draw();
-}
\ No newline at end of file
+}
+
+// ----------------------------------------------------------------------------
+// ObstacleGrid
+// a static set of walls indexed by a uniform grid on the XZ plane
+
+namespace {
+
+    // narrow [tEnter, tLeave] to the part of a path which lies within [0, size) along one axis, returns false if none of it does
+    bool clipToExtent(float o, float d, float size, float& tEnter, float& tLeave)
+    {
+		if (d == 0.0f)
+			return (o >= 0.0f) && (o < size);
+
+		float t0 = (0.0f - o) / d;
+		float t1 = (size - o) / d;
+
+		if (t0 > t1)
+		{
+			const float t = t0;
+			t0 = t1;
+			t1 = t;
+		}
+
+		tEnter	= max(tEnter, t0);
+		tLeave	= min(tLeave, t1);
+
+		return tEnter <= tLeave;
+    }
+
+    // Steps through the cells of a uniform grid crossed by a path on the XZ plane, in order along the path.  The path starts at (ox, oz) 
+    // relative to the grid's minimum corner, runs along the unit direction (dx, dz) and ends after "length" or at the edge of the grid.
+    class GridWalk
+    {
+		public:
+			GridWalk(float ox, float oz, float dx, float dz, float length, float sizex, float sizez, int divx, int divz)
+			{
+				float tEnter = 0.0f;
+
+				this->tLeave	= length;
+				this->divx		= divx;
+				this->divz		= divz;
+
+				this->valid = clipToExtent(ox, dx, sizex, tEnter, tLeave) && clipToExtent(oz, dz, sizez, tEnter, tLeave);
+				if (!valid)
+					return;
+
+				const float cellx = sizex / divx;
+				const float cellz = sizez / divz;
+
+				// cell containing the point where the path enters the grid
+				ix = (int)((ox + (dx * tEnter)) / cellx);
+				iz = (int)((oz + (dz * tEnter)) / cellz);
+				ix = (ix < 0) ? 0 : ((ix >= divx) ? divx - 1 : ix);
+				iz = (iz < 0) ? 0 : ((iz >= divz) ? divz - 1 : iz);
+
+				// distance along the path to the next cell boundary on each axis, and between successive boundaries
+				stepx	= (dx > 0.0f) ? 1 : -1;
+				stepz	= (dz > 0.0f) ? 1 : -1;
+				tDeltaX	= (dx != 0.0f) ? (cellx / fabs(dx)) : FLT_MAX;
+				tDeltaZ	= (dz != 0.0f) ? (cellz / fabs(dz)) : FLT_MAX;
+				tMaxX	= (dx != 0.0f) ? ((((ix + ((dx > 0.0f) ? 1 : 0)) * cellx) - ox) / dx) : FLT_MAX;
+				tMaxZ	= (dz != 0.0f) ? ((((iz + ((dz > 0.0f) ? 1 : 0)) * cellz) - oz) / dz) : FLT_MAX;
+			}
+
+			// distance along the path at which it leaves the current cell
+			float cellExit() const
+			{
+				return min(tMaxX, tMaxZ);
+			}
+
+			// move on to the next cell along the path, returns false once the path has ended
+			bool next()
+			{
+				if (cellExit() >= tLeave)
+					return false;
+
+				if (tMaxX < tMaxZ)
+				{
+					ix		+= stepx;
+					tMaxX	+= tDeltaX;
+					return (ix >= 0) && (ix < divx);
+				}
+				else
+				{
+					iz		+= stepz;
+					tMaxZ	+= tDeltaZ;
+					return (iz >= 0) && (iz < divz);
+				}
+			}
+
+			bool valid;				// does the path cross the grid at all?
+			int ix, iz;				// current cell
+
+		private:
+			int divx, divz;
+			int stepx, stepz;
+			float tMaxX, tMaxZ, tDeltaX, tDeltaZ, tLeave;
+    };
+
+} // anonymous namespace
+
+ObstacleGrid::ObstacleGrid(const Vec3& center, const Vec3& dimensions, const Vec3& divisions, float margin)
+: Obstacle()
+{
+	this->Position	= center;
+	this->origin	= center - (dimensions * 0.5f);
+	this->sizex		= dimensions.x;
+	this->sizez		= dimensions.z;
+	this->divx		= (int)divisions.x;
+	this->divz		= (int)divisions.z;
+	this->margin	= margin;
+
+	cells.resize(divx * divz);
+}
+
+ObstacleGrid::~ObstacleGrid()
+{
+	for (std::vector<Wall>::iterator w = walls.begin() ; w != walls.end() ; w++)
+		delete w->face;
+}
+
+void ObstacleGrid::addWall(const Vec3& Start, const Vec3& End)
+{
+	insertWall(Start, End, false, VEC3_ZERO);
+}
+
+// the same four faces as a BoxObstacle of the same size, so vehicles inside or outside it steer the same way
+void ObstacleGrid::addBox(const Vec3& Center, float w, float d)
+{
+	const float hw = 0.5f * w;
+    const float hd = 0.5f * d;
+
+	insertWall(Center + Vec3(-hw, 0.0f,  hd), Center + Vec3( hw, 0.0f,  hd), true, Center);
+	insertWall(Center + Vec3( hw, 0.0f, -hd), Center + Vec3(-hw, 0.0f, -hd), true, Center);
+	insertWall(Center + Vec3( hw, 0.0f,  hd), Center + Vec3( hw, 0.0f, -hd), true, Center);
+	insertWall(Center + Vec3(-hw, 0.0f, -hd), Center + Vec3(-hw, 0.0f,  hd), true, Center);
+}
+
+void ObstacleGrid::insertWall(const Vec3& Start, const Vec3& End, bool boxFace, const Vec3& boxCenter)
+{
+	Wall wall;
+	wall.face		= new RectangleObstacle(Start, End);
+	wall.boxFace	= boxFace;
+	wall.boxCenter	= boxCenter;
+
+	const int index = (int)walls.size();
+	walls.push_back(wall);
+
+	// walk the length of the wall, extended by the margin at each end, registering it with every cell crossed.  Any path which meets the 
+	// wall within a vehicle's radius of its ends does so at a point on this extended line, so it crosses one of these cells.
+	const Vec3 line			= (End - Start).setYtoZero();
+	const float length		= line.length();
+	const Vec3 direction	= (length > 0.0f) ? (line / length) : VEC3_SIDE;
+	const Vec3 from			= Start - (direction * margin) - origin;
+
+	GridWalk walk(from.x, from.z, direction.x, direction.z, length + (margin * 2.0f), sizex, sizez, divx, divz);
+	if (!walk.valid)
+		return;
+
+	do
+		cells[(walk.iz * divx) + walk.ix].push_back(index);
+	while (walk.next());
+}
+
+float ObstacleGrid::signedDistance(const Vec3& point) const
+{
+	float nearest	= FLT_MAX;
+	float sign		= 1.0f;
+
+	for (std::vector<Wall>::const_iterator w = walls.begin() ; w != walls.end() ; w++)
+	{
+		// closest point on the wall's segment, on the XZ plane
+		const RectangleObstacle& face = *(w->face);
+		const Vec3 offset		= (point - face.Start).setYtoZero();
+		const float along		= max(0.0f, min(offset.dot(face._side), face.width));
+		const float distance	= (offset - (face._side * along)).length();
+
+		if (distance < nearest)
+		{
+			nearest	= distance;
+			sign	= (w->boxFace && (offset.dot(face._forward) > 0.0f)) ? -1.0f : 1.0f;		// box faces point outwards
+		}
+	}
+
+	return nearest * sign;
+}
+
+OpenSteer::Vec3 ObstacleGrid::steerToAvoid(const AbstractVehicle& vehicle, const float minTimeToCollision)
+{
+	// only a wall within reach before minTimeToCollision can produce any steering, so the probe need go no further than that
+	PathIntersection pi = findIntersectionWithVehiclePath(vehicle, minTimeToCollision * vehicle._speed);
+
+	if (!pi.intersect)
+		return VEC3_ZERO;
+	else
+		return pi.steerToAvoidIfNeeded(vehicle, minTimeToCollision);
+}
+
+PathIntersection ObstacleGrid::findIntersectionWithVehiclePath(const AbstractVehicle& vehicle)
+{
+	return findIntersectionWithVehiclePath(vehicle, FLT_MAX);
+}
+
+PathIntersection ObstacleGrid::findIntersectionWithVehiclePath(const AbstractVehicle& vehicle, const float maxDistance)
+{
+	PathIntersection Current, Nearest;
+	const Wall* nearestWall = NULL;
+
+	const Vec3 from		= vehicle.Position - origin;
+	const Vec3 heading	= vehicle._forward.setYtoZero().normalize();
+
+	GridWalk walk(from.x, from.z, heading.x, heading.z, maxDistance, sizex, sizez, divx, divz);
+	if (!walk.valid)
+		return Nearest;
+
+	do
+	{
+		const std::vector<int>& cell = cells[(walk.iz * divx) + walk.ix];
+
+		for (std::vector<int>::const_iterator i = cell.begin() ; i != cell.end() ; i++)
+		{
+			const Wall& wall = walls[*i];
+
+			Current = wall.face->RectangleObstacle::findIntersectionWithVehiclePath(vehicle);
+
+			if (Current.intersect && ((!Nearest.intersect) || (Current.distance < Nearest.distance)))
+			{
+				Nearest		= Current;
+				nearestWall	= &wall;
+			}
+		}
+
+		// cells are walked in order along the path, so once the nearest intersection lies within those already walked nothing further can beat it
+		if (Nearest.intersect && (Nearest.distance <= walk.cellExit()))
+			break;
+	}
+	while (walk.next());
+
+    // when the intersection is with one side of a box, adjust PathIntersection for the box case
+	if ((nearestWall != NULL) && nearestWall->boxFace)
+		Nearest.steerHint = ((Nearest.surfacePoint - nearestWall->boxCenter).normalize () * (Nearest.vehicleOutside ? 1.0f : -1.0f));
+
+	return Nearest;
+}
@@ -49,6 +49,11 @@ using namespace OpenSteer;
 			{
 			} 
 
+			// a moving vehicle has come near; e.g. to wake a sleeping one
+			virtual void disturb(const AbstractVehicle& /*by*/)
+			{
+			}
+
 			float _maxForce;   // the maximum steering force this vehicle can apply (steering force is clipped to this magnitude)
 			float _radius;     // size of bounding sphere, for obstacle avoidance, etc.
 			float _speed;      // speed along Forward direction.  Because local space is velocity-aligned, velocity = Forward * Speed
@@ -4,6 +4,15 @@
 #include <algorithm>
 #include "OpenSteer/Proximity.h"
 #include "OpenSteer/Obstacle.h"
+#include "OpenSteer/FlowField.h"
+#include "OpenSteer/Orca.h"
+#include "OpenSteer/Scratch.h"
+#include "OpenSteer/CrowdGrid.h"
+#include "OpenSteer/Think.h"
+#include "OpenSteer/Profile.h"
+#include "OpenSteer/Random.h"
+#include "OpenSteer/Handle.h"
+#include "OpenSteer/Checkpoint.h"
 #include "OpenSteer/Boid.h"
 using namespace OpenSteer;
 
@@ -12,63 +21,168 @@ using namespace OpenSteer;
 
 #define RIGHT_HANDED	false
 
+#define OVERLAP_RELAXATION	1.5f		// over-relaxation of the non-penetration pass' averaged corrections
+
+#define SLEEP_SPEED			0.1f		// a boid moving slower than this...
+#define SLEEP_FORCE			0.5f		// ...and steering less than this...
+#define SLEEP_TICKS			30			// ...for this many updates in a row falls asleep until the crowd grid shows movement where it stands
+
+#define AGENT_SLAB			256			// boids pooled per slab
+
+// Most bytes a boid may take, checked at compile time.  A boid is 216 on Win32 and 256 on x64 (where its pointers are twice the size), which
+// leaves room for a field or two on each; with its pooled token & the pools' block headers, it's about 300 an agent in all on Win32.
+#ifdef _WIN64
+	#define AGENT_BUDGET	288
+#else
+	#define AGENT_BUDGET	256
+#endif
+
+#define AGENT_POOLS			4			// sizes of boid (Boid, Presence, ...) pooled separately; any others go to the heap
+
 #define INTERPOLATE(a, i, j)  	(i + ((j - i) * a))
 #define CLIP(f, lower, upper)	(f < lower) ? lower : ((f > upper) ? upper : f)
 
 typedef AbstractProximityDatabase<AbstractVehicle*> ProximityDatabase;
 typedef AbstractTokenForProximityDatabase<AbstractVehicle*> ProximityToken;
 
-class Force
-{
-	public:
-		Force(float Radius, float Angle, float Weight)
-		{
-			this->Radius	= Radius;
-			this->Angle		= Angle;
-			this->Weight	= Weight;
-		}
-		~Force()
-		{
-		}
-
-		float Radius, Angle, Weight;
-};
+class Group;
+class Script;
 
 class Boid : public AbstractVehicle
 {
 	public:
-		Boid(ProximityDatabase& pd, BoxObstacle* obstacles);
+		Boid(ProximityDatabase& pd, Obstacle* obstacles, int profile = 0, const Vec3* position = NULL);	// at a random position, if none's given
 		~Boid();
 
+		// boids are spawned & despawned in bulk, so come from a slab pool for each size of boid rather than each going to the heap
+		static void* operator new(size_t size);
+		static void operator delete(void* p, size_t size);
+		static size_t PoolBytes();		// reserved by the pools
+
 		void reset();
 		void update(const float currentTime, const float elapsedTime);	// per frame simulation update
 
+		// update() in two halves, so that every boid can choose its velocity from the others' current ones (in parallel) before any move
+		void planVelocity(const float elapsedTime);
+		void move(const float elapsedTime);
+
+		void moveTo(const Vec3& position);
+
+		RandomStream& randomStream()	{ return random; }		// this boid's own, for anything random it or its script does
+
+		bool isAsleep() const			{ return asleep; }
+		void disturb(const AbstractVehicle& by);		// by a group passing
+		void wake();
+
+		// for the non-penetration pass after moving: gather the flockmates close enough to overlap, then (repeatedly) find how far to move
+		// to push out of them and the walls
+		void findContacts();
+		float overlapCorrection(const DistanceField& walls, Vec3& correction) const;		// returns the deepest overlap
+
+		void setProfile(int profile);
+		int getProfile() const			{ return profile; }
+		const BehaviourProfile& behaviour() const	{ return (Profiles != NULL) ? Profiles->get(profile) : DefaultProfile; }
+
+		void setGoal(FlowFieldCache* flowFields, int goal, float weight);		// head for a shared goal, blended with flocking (goal -1 for none)
+
+		// a group member leaves the proximity database, where its group stands in for it, and steers to its slot in the formation
+		void joinGroup(Group* group, int slot);
+		void leaveGroup();
+		Group* getGroup() const			{ return group; }
+
+		// for the flock to find and remove a boid without searching
+		int getIndex() const			{ return index; }
+		void setIndex(int index)		{ this->index = index; }
+
+		// for anything outside the flock to refer to this boid by, safely after it's gone
+		AgentHandle getHandle() const	{ return handle; }
+		void setHandle(AgentHandle handle)	{ this->handle = handle; }
+
+		// the script this boid is following, if any, which is cancelled when the boid is deleted
+		Script* getScript() const		{ return script; }
+		void setScript(Script* script)	{ this->script = script; }
+
+		// this boid's entries in a checkpoint's arrays; restoring takes its profile's index in this run's table, and its goal (checked against
+		// the flow fields it's in, -1 for none), and puts it back in the proximity database where it stood (restore the flock in order of
+		// InsertionOrder)
+		void saveState(AgentColumns& columns, int i) const;
+		void restoreState(const AgentColumns& columns, int i, int profile, int goal, FlowFieldCache* flowFields);
+
+		static bool UseAggregates;		// approximate alignment & cohesion beyond the separation radius with the proximity database's bin aggregates
+		static bool UseOrca;			// avoid neighbours with reciprocal velocity obstacles instead of the separation force
+		static CrowdGrid* Crowd;		// crowd density & velocity for pressure steering and slowing down in a crush, or NULL for neither
+
+		static ProfileTable* Profiles;		// shared behaviour profiles, or NULL for every boid to behave as DefaultProfile
+		static const BehaviourProfile DefaultProfile;
+
+		static unsigned int Seed;		// of the random streams of boids constructed from now on...
+		static unsigned int Spawned;	// ...each numbered in turn from this
+
+		static ThinkScheduler* Thinking;	// staggers the decisions below, or NULL to make them every frame
+		static int ThinkAvoid;				// obstacle look-ahead
+		static int ThinkFlow;				// flow field lookup
+
 	protected:
 		Vec3 steerToFlock();											// basic flocking
 		void regenerateLocalSpace(const Vec3& newVelocity);
 		void applySteeringForce  (const Vec3& force, const float deltaTime);		// apply a given steering force to our momentum, adjusting our orientation to maintain velocity-alignment.
+		Vec3 steeredVelocity(const Vec3& force, const float deltaTime);		// the velocity a given steering force would give us
+		void applyVelocity(const Vec3& newVelocity, const float deltaTime);	// move with a given velocity, adjusting our orientation to match
 		Vec3 adjustRawSteeringForce (const Vec3& force, const float deltaTime);
 
 		Vec3 steerForSeparation();	// Separation behavior -- determines the direction away from nearby boids
 		Vec3 steerForAlignment();	// Alignment behavior
         Vec3 steerForCohesion();	// Cohesion behavior
+		Vec3 steerForFlow();		// Follow the flow field to the goal, if any
+		Vec3 steerForPressure();	// Pressure behavior -- away from where the crowd is packed tighter, from the crowd grid
+		Vec3 steerForCrowdAlignment();	// Alignment behavior, from the crowd grid rather than individual neighbors
+
+		Vec3 steerInFormation();		// in place of steerToFlock for a group member
+		Vec3 steerToSlot();				// Formation behavior -- keep pace with the group, closing on our slot in it
+		Vec3 steerForGroupSeparation();	// Separation behavior, from the other members of our group
+
+		bool thinks(int behaviour) const;	// is this boid due to make the given decision this frame?
+		void resetMotion();				// reset() but for the position, and so the proximity token
+		void fallAsleep();
 
 		bool inBoidNeighborhood(const AbstractVehicle& otherVehicle, const float minDistance, const float maxDistance, const float cosMaxAngle);
+		bool inAggregateNeighborhood(const ProximityAggregate& aggregate, const float maxDistance, const float cosMaxAngle);
 
-		BoxObstacle*	obstacles;		// group of all obstacles to be avoided by each Boid
-		ProximityToken*	proximityToken;		// a pointer to this boid's interface object for the proximity database
+		Obstacle*		obstacles;		// group of all obstacles to be avoided by each Boid
+		ProximityDatabase* database;
+		ProximityToken*	proximityToken;		// a pointer to this boid's interface object for the proximity database, NULL while in a group
 
-		std::vector<AbstractVehicle*> neighbors;
+		// in this frame's scratch arena of the thread which found them
+		ArenaRange<AbstractVehicle*> neighbors;
+		ArenaRange<ProximityAggregate> aggregates;		// distant groups of flockmates, only gathered when UseAggregates is set
+		ArenaRange<AbstractVehicle*> contacts;			// flockmates found by findContacts
 
-		float maxRadius;
+		float localDensity;				// from the crowd grid, at the start of this step
 
-		Force *Separation, *Alignment, *Cohesion;
+		bool asleep;					// not updating, and left in the proximity database where it stands
+		unsigned char profile;			// index into Profiles
+		int stillTicks;					// updates in a row under the sleep thresholds
 
-        Vec3 _lastForward;
-        Vec3 _lastPosition;
-        Vec3 _smoothedAcceleration;
+		int thinkSlot;
+		Vec3 avoidance;					// last decisions, reused between thinks
+		Vec3 flowDirection;
+
+		Vec3 plannedVelocity;			// chosen by planVelocity, for move
+
+		RandomStream random;
 
-		float _maxSpeed;   // the maximum speed this vehicle is allowed to move (velocity is clipped to this magnitude)
+		FlowFieldCache*	flowFields;		// shared flow fields, and the goal & weight to follow one with
+		int				goal;
+		float			goalWeight;
+
+		Group*			group;			// the group we're walking with, if any, and our slot in its formation
+		int				slot;
+
+		int				index;			// in the flock
+		Script*			script;
+		AgentHandle		handle;
+
+        Vec3 _smoothedAcceleration;
 };
 
 #endif
\ No newline at end of file
@@ -38,9 +38,23 @@
 //
 // ----------------------------------------------------------------------------
 
+#include <string>
 #include <vector>
 #include "OpenSteer/Proximity.h"
+#include "OpenSteer/DistanceField.h"
+#include "OpenSteer/FlowField.h"
+#include "OpenSteer/CrowdGrid.h"
+#include "OpenSteer/Script.h"
+#include "OpenSteer/Group.h"
+#include "OpenSteer/Spawn.h"
+#include "OpenSteer/Checkpoint.h"
+#include "OpenSteer/Trajectory.h"
+#include "OpenSteer/Rewind.h"
+#include "OpenSteer/WallFile.h"
 #include "../Presence.h"
+#include "../Benchmark.h"
+#include "../Parallel.h"
+#include "../Allocations.h"
 
 #define MAX_INSTANCES		4000
 #define DEFAULT_INSTANCES	100
@@ -50,6 +64,44 @@ using namespace OpenSteer;
 
 typedef std::vector<Presence*>			groupType;	// type for a flock: an STL vector of Boid pointers
 
+#define DETERMINISTIC_STEP		(1.0f / 60.0f)		// fixed time step of the deterministic mode...
+#define DETERMINISTIC_MAX_STEPS	4					// ...and the most it takes in one update to catch up
+#define SEED_PLUGIN_STREAM		0xFFFFFFFFu			// random stream of the plugin's own choices, numbered clear of the boids'
+#define CHECKPOINT_BENCHMARK	"Benchmark.checkpoint"	// written & read back by the checkpoint benchmark, then deleted
+#define TRAJECTORY_BENCHMARK	"Benchmark.trajectory"	// recorded & read back by the recording benchmark, then deleted
+#define PREWARM_CACHE			"Prewarm %s %u %08x.checkpoint"	// scenario, seed & a hash of the settings the crowd was warmed with
+
+#define OVERLAP_TOLERANCE	0.01f		// deepest overlap, in metres, that the non-penetration pass may leave
+#define OVERLAP_ITERATIONS	8			// most iterations it may take to get there
+
+// what the last non-penetration pass did
+class OverlapStats
+{
+	public:
+		int iterations;
+		float initialOverlap, finalOverlap;		// deepest overlap before & after
+		float seconds;
+};
+
+// An evening at the venue: to the bar for a drink, then to the dance floor for a while, and round again
+class NightOut : public Script
+{
+	public:
+		NightOut(int bar, int danceFloor);
+		void resume();
+
+	private:
+		int bar, danceFloor;
+};
+
+// Waits about, and nothing else
+class Loiter : public Script
+{
+	public:
+		Loiter();
+		void resume();
+};
+
 class BoidsPlugIn
 {
 	public:
@@ -61,18 +113,137 @@ class BoidsPlugIn
 		void close();
 		void reset();
 
+		void benchmark(Benchmark& results);		// time the crowd's subsystems against the current flock
+		void benchmarkOrca(Benchmark& results);	// time ORCA against separation for crowds of 10,000 - 100,000
+		void benchmarkDeterminism(Benchmark& results);	// check a seeded run is the same on one thread as on all of them
+		void benchmarkSpawning(Benchmark& results);		// time spawning & despawning a crowd of 100,000
+		void benchmarkAllocations(Benchmark& results);	// count the heap allocations of a warmed-up step (debug builds)
+		void benchmarkCheckpoint(Benchmark& results);	// time saving & restoring a crowd of 100,000, and check it carries on the same
+		void benchmarkRecording(Benchmark& results);	// time recording a crowd's trajectories, and seeking in the recording
+		void benchmarkRewind(Benchmark& results);		// time keeping a crowd's steps to rewind, and rewinding, and check it comes back the same
+
+		void formGroup(int size);			// the last few boids not already in a group set off round the venue together
+
+		// Boids are made & removed in bulk, from pools.  spawn() places them by the distribution given, or (with none) wherever each boid's
+		// reset() puts it, appending their handles to any vector given (and stopping short if the flock reaches HANDLE_SLOTS); despawn()
+		// cancels each boid's script, takes it out of its group and the proximity database, and moves the last of the flock into its place.
+		// Each boid given to despawn() must be in the flock, once; handles may be stale or repeated, and those are skipped.
+		void spawn(int count, const SpawnDistribution* where = NULL, std::vector<AgentHandle>* spawned = NULL);
+		void despawn(const std::vector<Boid*>& boids);
+		void despawn(const std::vector<AgentHandle>& boids);
+		Boid* find(AgentHandle handle) const	{ return handles.find(handle); }		// or NULL if the boid's gone
+
+		// Deterministic: the same seed, boids added and inputs give bit-identical boids on any number of threads, for replays & for checking
+		// optimisations against a golden run by checksum().  Steps are fixed, every boid plans its velocity before any moves (so the order
+		// doesn't matter), flow fields are built in step with the simulation, and the profiles file isn't reloaded.
+		bool Deterministic;
+		void seed(unsigned int seed);		// before adding boids, for a run to be reproduced from
+		unsigned int checksum() const;
+
+		// The whole crowd saved to a checkpoint file, or replaced by one (see Checkpoint), e.g. to start a scenario or a benchmark from a
+		// crowd already settled.  The proximity database is made again with the checkpoint's grid.  Restoring fails, leaving the crowd as it
+		// was, if the file is missing or isn't a checkpoint of this version.
+		bool saveCheckpoint(const char* filename) const;
+		bool restoreCheckpoint(const char* filename);
+
+		// Pre-warming: the crowd stepped on headless (deterministically, across every thread) for some seconds of crowd time before any of it
+		// is shown, so the first frames don't show it unravelling from where it was spawned.  The result can be kept as a checkpoint, named
+		// by prewarmCache() for the scenario, seed & settings, for later launches to restore instead.
+		void prewarm(float seconds);
+		std::string prewarmCache(const char* scenario, unsigned int seed, int count, float seconds) const;
+
+		// Every boid's position & heading recorded after each step, to a trajectory file (see TrajectoryRecorder) for analysis or replay
+		bool startRecording(const char* filename);
+		void stopRecording();
+		bool isRecording() const			{ return recorder.recording(); }
+		bool recordingFailed() const		{ return recorder.writeFailed(); }		// a write failed, so the recording stopped (still to be stopped here)
+		void recordCamera(const float viewProjection[TRAJECTORY_CAMERA])	{ recorder.camera(viewProjection); }
+
+		// Stepping back: every deterministic step kept in a rewind buffer of so many bytes (0 for none; see RewindBuffer).  rewind() goes
+		// back so many steps, or as far as the buffer goes, by restoring the keyframe before and stepping on from it to the very same crowd.
+		// A keyframe is a checkpoint, which doesn't keep groups & scripts, so while there are any the crowd isn't rewindable: its steps
+		// aren't kept and rewind() does nothing.  A step that isn't deterministic isn't kept either, and either empties the buffer.
+		void configureRewind(size_t bytes, int keyframeTicks = REWIND_KEYFRAME);
+		int rewind(int steps);				// the steps gone back
+		bool rewindable() const				{ return groups.empty() && (scripts->scriptCount() == 0); }
+		const RewindBuffer& rewindBuffer() const	{ return rewinder; }
+		size_t rewindBytes() const			{ return rewinder.reservedBytes() + keyframeImage.capacity(); }		// reserved, in all
+
+		bool EnforceRadius;					// push overlapping boids apart after they move
+		bool UseScripts;					// give each new boid a NightOut to follow
+		OverlapStats Overlaps;
+		int Awake, Asleep;					// boids in each state after the last update
+
 	protected:
-		void addBoidToFlock();
-		void removeBoidFromFlock();
+		class StandInCrowd;			// for the benchmarks' crowds of their own (see Boids.cpp)
+		friend class StandInCrowd;
 
 		void initObstacles();
+		void openDatabase();		// a new, empty proximity database over the grid below, in place of any there was
+
+		Vec3 databaseCenter;		// the proximity database's grid
+		Vec3 databaseDimensions;
+		Vec3 databaseDivisions;
+
+		void step(const float elapsedTime);
+		void stepFlock(const float elapsedTime);		// the boids themselves, after the goals, scripts & groups they follow
+
+		static void SplatBoids(int begin, int end, void* plugIn);
+		static void PlanVelocities(int begin, int end, void* plugIn);
+		void sortByProfile();		// fill planOrder with the boids awake, and sleepers with the rest
+		void wakeSleepers();		// any the crowd grid shows movement about, into planOrder
+
+		void resolveOverlaps();
+		static void FindContacts(int begin, int end, void* plugIn);
+		static void FindCorrections(int begin, int end, void* plugIn);
+		static void ApplyCorrections(int begin, int end, void* plugIn);
+
+		float stepTime;				// elapsed time of the update in progress, for PlanVelocities
+		float stepBacklog;			// time not yet stepped through, when deterministic
+		std::vector<Boid*> planOrder;	// the flock by behaviour profile, so each thread planning a run of it works from one profile at a time
+
+		// A sleeping boid, as far as a step's concerned: where it stands, to look up the crowd grid there, and who to wake if that shows movement
+		class Sleeper
+		{
+			public:
+				Boid* Sleeping;
+				Vec3 Position;
+		};
+		std::vector<Sleeper> sleepers;		// this step's, kept out of planOrder
+
+		std::vector<Vec3> corrections;		// per boid, for the non-penetration pass
+		std::vector<float> overlaps;
+		Benchmark overlapTimer;				// (kept, so timing a pass doesn't construct one each step)
 
 		// flock: a group (STL vector) of pointers to all boids
 		groupType flock;
+		HandleTable handles;		// to each boid of the flock
 
 		ProximityDatabase* pd;	// pointer to database used to accelerate proximity queries
 
-		BoxObstacle* insideBigBox;
+		ObstacleGrid* walls;		// static walls of the venue
+		DistanceField* obstacles;	// distance field baked from the walls, avoided by each boid
+		FlowFieldCache* flowFields;	// flow fields to shared goals, over the same area
+		CrowdGrid* crowd;			// density & velocity of the flock, splatted at the start of each update
+		ThinkScheduler thinking;	// staggers the boids' expensive decisions over frames
+		ProfileTable profiles;		// shared by the boids, & reloaded when the file changes
+		float profileCheck;			// seconds since the profiles file was last checked
+		RandomStream random;		// for the plugin's own random choices
+		ScriptRunner* scripts;		// the boids' scripted routines
+		std::vector<Group*> groups;	// of boids walking in formation
+
+		int bar, danceFloor;		// flow field goals for the scripts
+
+		TrajectoryRecorder recorder;	// of the flock's steps, while recording
+		void recordFrame();
+
+		RewindBuffer rewinder;
+		std::vector<char> keyframeImage;	// (kept, to save the next keyframe without going to the heap)
+		bool rewinding;						// stepping on from a keyframe, over steps already held?
+		void rewindFrame();
+
+		void saveImage(std::vector<char>& image) const;		// the crowd as a checkpoint, in memory
+		void restoreImage(const Checkpoint& checkpoint);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <windows.h>
+#include <vector>
+#include "OpenSteer/Vec3.h"
+#include "OpenSteer/Random.h"
+#include "OpenSteer/Profile.h"
+using namespace OpenSteer;
+
+#define CHECKPOINT_VERSION		1
+#define CHECKPOINT_ALIGNMENT	16		// of the header, the profiles & each array, so that a mapped view can be read where it lies
+#define CHECKPOINT_NAME_LENGTH	32		// of a profile's name, with its terminator
+
+struct CHECKPOINT_HEADER
+{
+	char			Magic[4];			// "OVCK"
+	unsigned int	Version;
+	unsigned int	Agents;
+	unsigned int	Profiles;
+
+	unsigned int	Seed;				// Boid::Seed & Boid::Spawned
+	unsigned int	Spawned;
+	RandomStream	Random;				// the plugin's own
+	unsigned int	ThinkFrame;			// the think scheduler's
+	int				ThinkSlot;
+	float			StepBacklog;
+
+	Vec3			Center;				// of the proximity database's grid
+	Vec3			Dimensions;
+	Vec3			Divisions;
+};
+
+struct CHECKPOINT_PROFILE
+{
+	char			Name[CHECKPOINT_NAME_LENGTH];
+	float			Separation[3];		// radius, angle & weight
+	float			Alignment[3];
+	float			Cohesion[3];
+	float			MaxSpeed, MaxForce, Radius, Share;
+	int				Category;
+	unsigned int	FlocksWith;
+};
+
+// A boid's state as arrays of each field by agent, pointing into a checkpoint file (or the buffer it's written from).  Boid::saveState &
+// restoreState fill & read one agent's entries.
+class AgentColumns
+{
+	public:
+		size_t bind(char* base, unsigned int agents);		// point each array into base, laid out one after the other; returns the bytes
+
+		Vec3*			Position;
+		Vec3*			Forward;
+		Vec3*			Side;
+		Vec3*			SmoothedAcceleration;
+		Vec3*			Avoidance;
+		Vec3*			FlowDirection;
+		float*			Speed;
+		float*			MaxForce;
+		float*			Radius;
+		float*			GoalWeight;
+		int*			Goal;
+		int*			ThinkSlot;
+		int*			StillTicks;
+		int*			InsertionOrder;		// in the proximity database, for the boids to be put back in the same order
+		RandomStream*	Random;
+		unsigned char*	Profile;
+		unsigned char*	Asleep;
+};
+
+// A snapshot of a whole crowd, written in one piece as it's laid out in memory: the header, the behaviour profiles the boids refer to by
+// index, then an array for each field of the boids (see AgentColumns).  Reading one maps the file rather than parsing it; everything is
+// used where it lies in the mapped view, and only the proximity database's grid has to be built again as the boids are put back (in the
+// order they were found in, so that a deterministic crowd steps on exactly as it would have; bin aggregates are summed afresh, so may
+// differ in the last bits).  Groups, scripts & flow fields aren't part of it: the boids come back walking alone, towards the goals they had.
+class Checkpoint
+{
+	public:
+		Checkpoint();
+		~Checkpoint();
+
+		bool map(const char* filename);		// fails if missing, another version or the wrong size, leaving nothing mapped
+		bool bind(const char* image, size_t bytes);		// or one already in memory (kept by the caller), checked the same way
+		void unmap();
+
+		const CHECKPOINT_HEADER& header() const			{ return *(const CHECKPOINT_HEADER*)view; }
+		const CHECKPOINT_PROFILE* profiles() const		{ return (const CHECKPOINT_PROFILE*)(view + ProfilesOffset()); }
+		const AgentColumns& columns() const				{ return agents; }
+
+		// the file's layout for a crowd: where the profiles and the agents' arrays start, and the bytes in all
+		static size_t ProfilesOffset();
+		static size_t AgentsOffset(unsigned int profiles);
+		static size_t Bytes(unsigned int agents, unsigned int profiles);
+
+		// writing one: an image of Bytes() laid out as above (zeroed first, so the padding is too), filled in & written whole
+		static bool Write(const char* filename, const std::vector<char>& image);
+		static void SaveProfile(const BehaviourProfile& profile, CHECKPOINT_PROFILE& saved);
+		static BehaviourProfile LoadProfile(const CHECKPOINT_PROFILE& saved);
+
+	private:
+		HANDLE file, mapping;
+		const char* view;
+		AgentColumns agents;
+};
+
+#endif
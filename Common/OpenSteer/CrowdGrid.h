@@ -0,0 +1,42 @@
+#ifndef _CROWD_GRID_H_
+#define _CROWD_GRID_H_
+
+#include <windows.h>
+#include <vector>
+#include "OpenSteer/AbstractVehicle.h"
+using namespace OpenSteer;
+
+#define CROWD_REST_DENSITY	1.5f		// agents per square metre above which the crowd pushes outward
+#define CROWD_PACKED		2.5f		// ...above which an agent steers from the grid alone, without looking at its neighbours
+#define CROWD_JAM_DENSITY	5.4f		// ...at which nobody moves (Weidmann's fundamental diagram)
+
+// Crowd density and average velocity over a grid on the XZ plane, splatted from every agent at the start of each step.  Where the crowd is
+// packed, steering from these (down the pressure gradient, along with the flow) replaces looking at each neighbour, so costs the same however
+// many neighbours there are.
+class CrowdGrid
+{
+	public:
+		CrowdGrid(const Vec3& center, const Vec3& dimensions, float cellSize);
+
+		void clear();
+		void splat(const AbstractVehicle& vehicle);				// may be called from several threads at once
+
+		float density(const Vec3& position) const;				// agents per square metre, bilinearly filtered
+		Vec3 velocity(const Vec3& position) const;				// average velocity of the agents about the position
+		Vec3 pressureGradient(const Vec3& position) const;		// direction (& steepness) of increasing crowd pressure
+
+		static float speedFactor(float density);				// fraction of its free speed an agent can walk at in a given density
+
+	private:
+		bool cellCoords(const Vec3& position, int& ix, int& iz, float& fx, float& fz) const;
+		float pressure(const Vec3& position) const;
+
+		Vec3 origin;							// minimum X and Z corner of the grid
+		float cellSize;
+		int divx, divz;
+
+		// sums of each agent's splat weight (& weighted velocity), in fixed point so they can be added to atomically
+		std::vector<LONG> weights, vx, vz;
+};
+
+#endif
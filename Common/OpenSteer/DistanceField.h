@@ -0,0 +1,49 @@
+#ifndef _DISTANCE_FIELD_H_
+#define _DISTANCE_FIELD_H_
+
+#include <vector>
+#include "OpenSteer/Obstacle.h"
+using namespace OpenSteer;
+
+// A signed distance field baked once from an ObstacleGrid over the walkable area, holding the distance to the nearest wall (negative on the
+// outside of a box) and its gradient at the centre of each cell.  Most vehicles are nowhere near a wall, and the field lets them skip the
+// path intersection test altogether; those within reach of a wall steer along the gradient, away from it.  Vehicles outside the field fall
+// back to the exact test against the walls.
+class DistanceField : public Obstacle
+{
+	public:
+		DistanceField(ObstacleGrid& walls, const Vec3& center, const Vec3& dimensions, float cellSize);
+		~DistanceField();
+
+		void bake();									// (re)compute every cell from the walls, e.g. after walls are added
+
+		bool contains(const Vec3& point) const;
+		float distance(const Vec3& point) const;		// bilinearly filtered distance to the nearest wall
+		Vec3 gradient(const Vec3& point) const;			// unit direction of increasing distance, i.e. away from the nearest wall
+
+		Vec3 steerToAvoid(const AbstractVehicle& v, const float minTimeToCollision);
+		PathIntersection findIntersectionWithVehiclePath(const AbstractVehicle& vehicle);	// exact, from the walls
+
+		unsigned int memoryBytes() const;
+		float bakeSeconds;								// how long the last bake took
+
+	private:
+		class Sample
+		{
+			public:
+				float distance;
+				float gx, gz;							// gradient of distance
+		};
+
+		const Sample& sample(int ix, int iz) const		{ return samples[(iz * divx) + ix]; }
+		void cellCoords(const Vec3& point, int& ix, int& iz, float& fx, float& fz) const;
+
+		ObstacleGrid* walls;
+		Vec3 origin;									// minimum X and Z corner of the field
+		float cellSize;
+		int divx, divz;
+
+		std::vector<Sample> samples;					// row-major in Z
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef _FLOW_FIELD_H_
+#define _FLOW_FIELD_H_
+
+#include <windows.h>
+#include <deque>
+#include <vector>
+#include "OpenSteer/DistanceField.h"
+using namespace OpenSteer;
+
+#define FLOW_BLOCKED	-1.0f		// cost grid value for a cell no agent can stand in
+
+// The cost of reaching one goal from every cell of a grid over the venue, and the neighbouring cell to step to from each.  Built by a
+// Dijkstra sweep outward from the goal over a grid of per-cell traversal costs.  When some cells' costs change, only the cells whose route
+// ran through them are found again (repaired) rather than sweeping the whole grid.
+class FlowField
+{
+	public:
+		FlowField(int goalCell, int divx, int divz);
+
+		void sweep(const std::vector<float>& costs, float cellSize);										// from scratch
+		void repair(const std::vector<float>& costs, const std::vector<int>& changed, float cellSize);	// after the given cells' costs changed
+
+		int goalCell;
+		int divx, divz;
+
+		std::vector<float>	distance;		// cost of the route to the goal, FLT_MAX where the goal can't be reached
+		std::vector<char>	step;			// neighbour to step to from each cell (see FlowField.cpp), -1 at the goal or where it can't be reached
+
+	private:
+		int neighbour(int cell, int k) const;		// index of a cell's k-th neighbour, -1 if off the grid
+		float edgeCost(const std::vector<float>& costs, int from, int k, float cellSize) const;	// cost of stepping to the k-th neighbour, FLT_MAX if it can't be done
+		void relax(const std::vector<float>& costs, std::vector< std::pair<float, int> >& open, float cellSize);
+};
+
+// Flow fields for any number of shared goals (exits, bars, stages...), built once per goal on a worker thread and cached, so thousands of
+// agents can head for the same goal for the price of one lookup each.  When the obstacles change the cost grid is read again and each field
+// is repaired, also on the worker thread; agents keep following the previous field until the new one is published.
+class FlowFieldCache
+{
+	public:
+		FlowFieldCache(DistanceField& obstacles, const Vec3& center, const Vec3& dimensions, float cellSize, float clearance);
+		~FlowFieldCache();
+
+		int addGoal(const Vec3& goal);										// returns the goal's id, its field is built on the worker thread
+		bool ready(int goal) const;
+		Vec3 goalPosition(int goal) const					{ return goals[goal]; }
+		int goalCount() const								{ return (int)goals.size(); }
+		Vec3 direction(int goal, const Vec3& position) const;				// unit direction towards the goal, or zero until its field is ready
+
+		void obstaclesChanged();											// re-read the cost grid from the obstacles & repair every field
+		void update(bool synchronous = false);								// publish finished fields & start new jobs, once per frame from the simulation thread;
+																			// synchronous builds them there & then, so they're ready on the same frame every run
+
+	private:
+		class Job
+		{
+			public:
+				int					goal;
+				FlowField*			field;
+				std::vector<float>	costs;			// snapshot of the cost grid to build against
+				std::vector<int>	changed;		// cells changed since the field was last built, or empty to sweep from scratch
+		};
+
+		void readCosts(std::vector<float>& costs) const;
+		void publish();														// the worker's finished jobs
+		void build(Job* job) const;
+		int cellFor(const Vec3& position) const;
+
+		static unsigned __stdcall Worker(void* cache);
+
+		DistanceField* obstacles;
+		Vec3 origin;							// minimum X and Z corner of the grid
+		float cellSize, clearance;
+		int divx, divz;
+
+		std::vector<float> costs;				// current cost grid
+
+		std::vector<FlowField*> fields;			// published field for each goal, NULL until first built
+		std::vector<Vec3> goals;
+		std::vector<int> goalCells;
+		std::vector<bool> building;				// is a job in flight for this goal?  (only one at a time, so repairs apply in order)
+		std::vector<bool> swept;				// has a job to sweep this goal's field from scratch been started?
+		std::vector< std::vector<int> > dirty;	// cells changed since this goal's field (or its job in flight) was started
+
+		HANDLE				thread, wake;
+		CRITICAL_SECTION	lock;				// guards pending, finished & quit
+		std::deque<Job*>	pending, finished;
+		bool				quit;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef _GROUP_H_
+#define _GROUP_H_
+
+#include <vector>
+#include "OpenSteer/Boid.h"
+
+#define FORMATION_SPACING	1.2f		// metres between slots, across and along the formation
+#define FORMATION_GAIN		2.0f		// how hard members close on their slots (per second of error)
+#define FORMATION_SLACK		3.0f		// the leader slows as the furthest member falls this far behind its slot
+
+// A group of friends moving through the venue together, two abreast behind a leader following a shared path.  To everyone else the group is
+// a single vehicle in the proximity database, the size of the whole formation; its members leave the database, and steer only to their slots
+// and apart from each other, so a group makes one query a frame rather than one per member.
+class Group : public AbstractVehicle
+{
+	public:
+		Group(ProximityDatabase& pd, const std::vector<Vec3>& path, float speed);
+		~Group();
+
+		void add(Boid* member);						// joins the back of the formation
+		void remove(Boid* member);					// e.g. as it's deleted; the rest close up behind
+		void update(const float elapsedTime);		// before the members plan their steering
+
+		Vec3 slotPosition(int slot) const;
+		Vec3 velocity() const						{ return _forward * _speed; }
+		const std::vector<Boid*>& getMembers() const	{ return members; }
+
+	private:
+		void arrangeSlots();
+
+		ProximityToken*			proximityToken;
+		std::vector<AbstractVehicle*> nearby;		// scratch, for disturbing those the group passes
+
+		std::vector<Vec3>		path;				// looped round
+		size_t					waypoint;
+		float					cruiseSpeed;
+		Vec3					leader;				// position at the head of the formation
+
+		std::vector<Boid*>		members;
+		std::vector<Vec3>		offsets;			// of each slot from the leader, across (x) and along (z) the formation
+		Vec3					centre;				// of the slots, likewise
+};
+
+#endif
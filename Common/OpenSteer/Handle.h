@@ -0,0 +1,49 @@
+#ifndef _HANDLE_H_
+#define _HANDLE_H_
+
+#include <stddef.h>
+#include <vector>
+
+#define HANDLE_INDEX_BITS	20									// a handle is its slot in the table...
+#define HANDLE_INDEX_MASK	((1u << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_SLOTS		HANDLE_INDEX_MASK					// (up to 1,048,575 agents at once, the last index being the free list's end)
+#define HANDLE_GENERATIONS	(1u << (32 - HANDLE_INDEX_BITS))	// ...and the slot's generation, counting its reuses round to 1 again
+#define HANDLE_NONE			0u									// (never issued: generations start at 1)
+
+class Boid;
+
+typedef unsigned int AgentHandle;
+
+// Handles for agents which stay safe to hold when agents are removed or the flock is reordered.  Each slot of the table points to its agent
+// and counts how many times it's been reused; a handle carries the slot and the count when it was issued, so a handle to an agent which has
+// gone no longer matches and finds nothing.  Freed slots are reused oldest first, so a stale handle could only be mistaken for a live one
+// after its slot had been round HANDLE_GENERATIONS agents.
+class HandleTable
+{
+	public:
+		HandleTable();
+
+		AgentHandle add(Boid* agent);			// HANDLE_NONE if HANDLE_SLOTS agents hold handles already
+		void remove(AgentHandle handle);		// (a stale handle is ignored)
+		Boid* find(AgentHandle handle) const	// or NULL if the agent's gone
+		{
+			const unsigned int index = handle & HANDLE_INDEX_MASK;
+			return ((index < slots.size()) && (slots[index].generation == (handle >> HANDLE_INDEX_BITS))) ? slots[index].agent : NULL;
+		}
+
+		int count() const						{ return live; }
+
+	private:
+		struct Slot
+		{
+			Boid*			agent;
+			unsigned int	generation;
+			unsigned int	next;				// the next free slot, while free
+		};
+
+		std::vector<Slot> slots;
+		unsigned int firstFree, lastFree;		// a queue of free slots, through next (HANDLE_INDEX_MASK for none)
+		int live;
+};
+
+#endif
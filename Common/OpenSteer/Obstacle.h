@@ -77,7 +77,7 @@ class Obstacle
 		Obstacle();
         ~Obstacle();
         
-        Vec3 steerToAvoid(const AbstractVehicle& v, const float minTimeToCollision);		// compute steering for a vehicle to avoid this obstacle, if needed 
+        virtual Vec3 steerToAvoid(const AbstractVehicle& v, const float minTimeToCollision);		// compute steering for a vehicle to avoid this obstacle, if needed 
 		virtual PathIntersection findIntersectionWithVehiclePath(const AbstractVehicle& vehicle) = NULL;	// find first intersection of a vehicle's path with this obstacle (this must be specialized for each new obstacle shape class)
 
 		Vec3 _forward, _side, Position;
@@ -117,4 +117,45 @@ class BoxObstacle : public Obstacle
 		ObstacleGroup faces;
 };
 
+// A static set of walls, and boxes taken as their four walls, indexed by a uniform grid on the XZ plane.  A vehicle's path is only tested 
+// against the walls registered in the cells it crosses, so the cost of avoidance follows the walls near the vehicle rather than the size of 
+// the set.  Each wall is registered along its length plus a margin at each end, which should be at least the largest vehicle radius.
+class ObstacleGrid : public Obstacle
+{
+	public:
+		ObstacleGrid(const Vec3& center, const Vec3& dimensions, const Vec3& divisions, float margin);
+		~ObstacleGrid();
+
+		void addWall(const Vec3& Start, const Vec3& End);
+		void addBox(const Vec3& Center, float w, float d);
+
+		Vec3 steerToAvoid(const AbstractVehicle& v, const float minTimeToCollision);		// as Obstacle, but only probing as far as the vehicle could collide
+		PathIntersection findIntersectionWithVehiclePath(const AbstractVehicle& vehicle);
+		PathIntersection findIntersectionWithVehiclePath(const AbstractVehicle& vehicle, const float maxDistance);
+
+		float signedDistance(const Vec3& point) const;		// distance to the nearest wall, negative on the outside of a box (tests every wall)
+
+		int wallCount() const { return (int)walls.size(); }
+		const RectangleObstacle& wall(int i) const { return *walls[i].face; }		// boxes' included, four faces apiece
+
+	private:
+		class Wall
+		{
+			public:
+				RectangleObstacle*	face;
+				bool				boxFace;		// is this one side of a box?  If so, steer relative to the box as BoxObstacle does.
+				Vec3				boxCenter;
+		};
+
+		void insertWall(const Vec3& Start, const Vec3& End, bool boxFace, const Vec3& boxCenter);	// store a wall and register it with every cell along it
+
+		Vec3 origin;					// minimum X and Z corner of the grid
+		float sizex, sizez;				// extent of the grid
+		int divx, divz;					// number of cells along each axis
+		float margin;
+
+		std::vector<Wall> walls;
+		std::vector< std::vector<int> > cells;		// indices into walls for each cell, row-major in Z
+};
+
 #endif
@@ -0,0 +1,38 @@
+#ifndef _ORCA_H_
+#define _ORCA_H_
+
+#include <vector>
+#include "OpenSteer/AbstractVehicle.h"
+using namespace OpenSteer;
+
+#define ORCA_RADIUS			3.0f		// how far to look for neighbours to avoid
+#define ORCA_NEIGHBOURS		10			// at most this many of the nearest are avoided
+#define ORCA_TIME_HORIZON	1.0f		// seconds ahead that collisions with neighbours are avoided for
+
+// Optimal reciprocal collision avoidance (van den Berg et al., as in the RVO2 library) on the XZ plane.  Each neighbour rules out the half of
+// velocity space that would bring the two into collision within the time horizon, assuming each takes half the responsibility for avoiding
+// it, and a 2D linear program picks the permitted velocity nearest the preferred one.  Only the vehicle's own state is written, so every
+// vehicle's new velocity can be solved independently, in parallel, from its neighbours' current velocities.  The working space kept between
+// solves is shared by whatever vehicles one thread solves for.
+class Orca
+{
+	public:
+		Vec3 solve(const AbstractVehicle& vehicle, const Vec3& preferred, AbstractVehicle* const* first, AbstractVehicle* const* last, float maxSpeed, float timeStep);		// neighbours in [first, last)
+
+	private:
+		class Line			// the permitted half-plane lies to the left of the line
+		{
+			public:
+				float px, pz;	// point on the line
+				float dx, dz;	// unit direction
+		};
+
+		bool linearProgram1(const std::vector<Line>& lines, size_t lineNo, float radius, float optX, float optZ, bool directionOpt, float& resultX, float& resultZ) const;
+		size_t linearProgram2(const std::vector<Line>& lines, float radius, float optX, float optZ, bool directionOpt, float& resultX, float& resultZ) const;
+		void linearProgram3(size_t beginLine, float radius, float& resultX, float& resultZ);
+
+		std::vector<std::pair<float, AbstractVehicle*> > nearest;		// scratch space, kept to save reallocating every step
+		std::vector<Line> lines, projected;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <stddef.h>
+
+#define POOL_ALIGNMENT	16			// each block's header, and the object after it, are kept to multiples of this
+
+// Fixed-size blocks for objects made and destroyed in their thousands (agents, proximity tokens), carved from slabs of many blocks at a
+// time.  Each block is headed by the slab it came from, so releasing one is a push onto that slab's free list; a slab whose blocks have all
+// been released goes back to the heap, except for one kept spare so that spawning & despawning about a slab boundary doesn't thrash.  Not
+// thread-safe: blocks are taken and given back by the simulation thread.
+class SlabPool
+{
+	public:
+		SlabPool(size_t blockSize, int blocksPerSlab);
+		~SlabPool();
+
+		void* allocate();
+		void release(void* p);
+
+		int liveCount() const			{ return live; }
+		size_t reservedBytes() const	{ return (size_t)slabs * slabBytes; }
+
+	private:
+		struct Slab;
+
+		struct Block
+		{
+			Slab*	slab;
+			Block*	next;				// on its slab's free list, while free
+		};
+
+		struct Slab
+		{
+			Slab*	prev;				// on the pool's list of slabs with blocks free
+			Slab*	next;
+			Block*	free;
+			int		used;				// blocks handed out
+			int		carved;				// blocks carved from the slab so far; the rest are untouched
+			bool	listed;
+		};
+
+		void list(Slab* slab);
+		void unlist(Slab* slab);
+
+		size_t blockBytes;				// header & object
+		size_t slabBytes;
+		int blocksPerSlab;
+
+		Slab* partial;					// slabs with blocks free, most recently released first
+		Slab* spare;					// an empty slab kept back from the heap, if any
+		int slabs, live;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include "OpenSteer/Proximity.h"
+
+#define BEHAVIOUR_PROFILES	"Profiles.txt"		// behaviour profiles, read by the Boids plugin on open & again whenever the file changes
+#define MAX_PROFILES		256					// boids hold their profile's index in a byte
+
+class Force
+{
+	public:
+		Force(float Radius, float Angle, float Weight)
+		{
+			this->Radius	= Radius;
+			this->Angle		= Angle;
+			this->Weight	= Weight;
+		}
+		~Force()
+		{
+		}
+
+		float Radius, Angle, Weight;
+};
+
+// How one kind of boid flocks and moves.  Every boid following a profile shares the one copy, referring to it by index, so a population can
+// be given its own weights (and have them changed while running) without each boid carrying its own.
+class BehaviourProfile
+{
+	public:
+		BehaviourProfile();			// as every boid behaved before there were profiles
+
+		float maxRadius() const;	// furthest any of the three forces reaches
+
+		std::string Name;
+
+		Force Separation, Alignment, Cohesion;
+		float MaxSpeed, MaxForce, Radius;
+
+		float Share;				// of new boids given this profile, relative to the other profiles' shares
+
+		int Category;				// population (e.g. patrons, staff, security) these boids are found as in the proximity database
+		unsigned int FlocksWith;	// mask of the populations they flock with, a bit per category; the rest are left to ORCA & the
+									// non-penetration pass to keep apart
+};
+
+// Behaviour profiles by index, starting with "default".  Loaded from a text file of one profile per line:
+//
+//		name  separation radius angle weight  alignment radius angle weight  cohesion radius angle weight  max-speed max-force radius share
+//		[category flocks-with]
+//
+// with # starting a comment, and the flocks-with mask in hex.  Without the last two, a profile is in category 0 and flocks with everyone.
+// A profile is never removed once added, so boids' indices stay valid through a reload; one named again replaces the old values in place.
+class ProfileTable
+{
+	public:
+		ProfileTable();
+
+		int count() const								{ return (int)profiles.size(); }
+		const BehaviourProfile& get(int profile) const	{ return profiles[profile]; }
+
+		int find(const std::string& name) const;		// -1 if there's no such profile
+		int add(const BehaviourProfile& profile);		// returns its index, or -1 if the table is full
+		int pick(float random) const;					// a profile by share, for random in [0, 1)
+
+		bool load(const char* filename);				// fails if the file can't be read, leaving the table as it was
+		bool reload();									// load again if the file has changed since; true if it did
+
+	private:
+		std::vector<BehaviourProfile> profiles;
+
+		std::string filename;
+		FILETIME written;								// when the file was last written, as of the last load
+};
+
+#endif
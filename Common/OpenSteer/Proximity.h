@@ -45,15 +45,53 @@
 #include <vector>
 #include "OpenSteer/Vec3.h"
 #include "OpenSteer/lq.h"   // XXX temp?
+#include "OpenSteer/Pool.h"
 using namespace OpenSteer;
 
+#define PROXIMITY_CATEGORIES	LQ_CATEGORIES		// tokens are each in one category, 0 to PROXIMITY_CATEGORIES - 1...
+#define PROXIMITY_ALL			0xFFFFFFFFu			// ...and queries take a mask of the categories to find, a bit per category
+
+#define PROXIMITY_TOKEN_SLAB	1024				// tokens pooled per slab
+
+// summary of a group of neighbors (e.g. one bin of a lattice) reported in place of its members by an aggregated neighbor search
+class ProximityAggregate
+{
+	public:
+		int count;							// number of neighbors summarised
+		Vec3 positionSum;					// sum of their positions
+		Vec3 forwardSum;					// sum of their headings
+};
+
 // "tokens" are the objects manipulated by the spatial database
 template <class ContentType> class AbstractTokenForProximityDatabase
 {
 	public:
 		virtual ~AbstractTokenForProximityDatabase() {}
 		virtual void updateForNewPosition (const Vec3& position) = 0;	// the client object calls this each time its position changes
-		virtual void findNeighbors (const Vec3& center, const float radius, std::vector<ContentType>& results) = 0;		// find all neighbors within the given sphere (as center and radius)
+		virtual void findNeighbors (const Vec3& center, const float radius, std::vector<ContentType>& results, unsigned int categories = PROXIMITY_ALL) = 0;		// find all neighbors of the given categories within the given sphere (as center and radius)
+
+		virtual void setCategory (int category) = 0;		// takes effect at the next position update
+
+		// as updateForNewPosition, also recording the client's heading for databases which keep aggregates
+		virtual void updateForNewPositionAndHeading (const Vec3& position, const Vec3& /*forward*/)
+		{
+			updateForNewPosition(position);
+		}
+
+		// find neighbors within the given sphere, but those further than exactRadius may be reported as aggregates rather than individually.
+		// By default every neighbor is exact.
+		virtual void findNeighborsAggregated (const Vec3& center, const float exactRadius, const float radius, std::vector<ContentType>& results, std::vector<ProximityAggregate>& /*aggregates*/, unsigned int categories = PROXIMITY_ALL)
+		{
+			findNeighbors(center, radius, results, categories);
+		}
+
+		// where this token comes in the order neighbors are found in: new tokens for the same clients, added in order of this number (lowest
+		// first) at the same positions, are found in the same order as these are, e.g. for a restored checkpoint to step exactly as the
+		// original would have.  Good from the database's orderInsertions() until the tokens next move.  By default the order isn't kept.
+		virtual int insertionOrder () const
+		{
+			return 0;
+		}
 };
 
 // abstract type for all kinds of proximity databases
@@ -63,6 +101,7 @@ template <class ContentType> class AbstractProximityDatabase
 		typedef AbstractTokenForProximityDatabase<ContentType> tokenType;		// type for the "tokens" manipulated by this spatial database
 		virtual ~AbstractProximityDatabase() {}
 		virtual tokenType* allocateToken (ContentType parentObject) = 0;		// allocate a token to represent a given client object in this database
+		virtual void orderInsertions () {}									// ready every token's insertionOrder(), all at once
 };
 
 // This is the "brute force" O(n^2) approach implemented in terms of the AbstractProximityDatabase protocol so it can be compared directly to 
@@ -87,13 +126,18 @@ template <class ContentType> class BruteForceProximityDatabase : public Abstract
 					// vector.
 					bfpd = &pd;
 					object = parentObject;
+					category = 0;
+					index = (int)bfpd->group.size();
 					bfpd->group.push_back(this);
 				}
 
 				virtual ~tokenType ()
 				{
-					// remove this token from the database's vector
-					bfpd->group.erase(std::find (bfpd->group.begin(), bfpd->group.end(), this));
+					// remove this token from the database's vector, moving the last into its place
+					tokenType* last = bfpd->group.back();
+					last->index = index;
+					bfpd->group[index] = last;
+					bfpd->group.pop_back();
 				}
 
 				// the client object calls this each time its position changes
@@ -102,14 +146,28 @@ template <class ContentType> class BruteForceProximityDatabase : public Abstract
 					position = newPosition;
 				}
 
-				// find all neighbors within the given sphere (as center and radius)
-				void findNeighbors (const Vec3& center, const float radius, std::vector<ContentType>& results)
+				void setCategory (int newCategory)
+				{
+					category = newCategory;
+				}
+
+				// searched in the order of the database's vector
+				int insertionOrder () const
+				{
+					return index;
+				}
+
+				// find all neighbors of the given categories within the given sphere (as center and radius)
+				void findNeighbors (const Vec3& center, const float radius, std::vector<ContentType>& results, unsigned int categories = PROXIMITY_ALL)
 				{
 					// loop over all tokens
 					const float r2 = radius * radius;
 
 					for (std::vector<tokenType*>::const_iterator i = bfpd->group.begin() ; i != bfpd->group.end(); i++)
 					{
+						if (!(categories & (1u << (**i).category)))
+							continue;
+
 						const Vec3 offset = center - (**i).position;
 						const float d2 = offset.lengthSquared();
 
@@ -122,6 +180,8 @@ template <class ContentType> class BruteForceProximityDatabase : public Abstract
 				BruteForceProximityDatabase* bfpd;
 				ContentType object;
 				Vec3 position;
+				int category;
+				int index;			// in the database's vector
 		};
 
 		// allocate a token to represent a given client object in this database
@@ -161,10 +221,16 @@ template <class ContentType> class LQProximityDatabase : public AbstractProximit
 			public:
 	            tokenType (ContentType parentObject, LQProximityDatabase& lqsd)
 		        {
-					proxy.prev   = NULL;
-					proxy.next   = NULL;
-					proxy.bin    = NULL;
-					proxy.object = parentObject;
+					proxy.prev		= NULL;
+					proxy.next		= NULL;
+					proxy.bin		= NULL;
+					proxy.aggregate	= NULL;
+					proxy.object	= parentObject;
+					proxy.category	= 0;
+					proxy.order		= 0;
+					proxy.fx		= 0.0f;
+					proxy.fy		= 0.0f;
+					proxy.fz		= 0.0f;
 
 					lq = lqsd.lq;
 				}
@@ -174,20 +240,73 @@ template <class ContentType> class LQProximityDatabase : public AbstractProximit
 					lqRemoveFromBin (&proxy);
 				}
 
+				// tokens come and go with their agents, so are pooled rather than each going to the heap
+				static void* operator new (size_t /*size*/)
+				{
+					return Pool().allocate();
+				}
+
+				static void operator delete (void* p)
+				{
+					Pool().release(p);
+				}
+
+				static SlabPool& Pool()
+				{
+					static SlabPool pool(sizeof(tokenType), PROXIMITY_TOKEN_SLAB);
+					return pool;
+				}
+
 				// the client object calls this each time its position changes
 				void updateForNewPosition (const Vec3& p)
 				{
 					lqUpdateForNewLocation (lq, &proxy, p.x, p.y, p.z);
 				}
 
-				// find all neighbors within the given sphere (as center and radius)
-				void findNeighbors (const Vec3& center, const float radius, std::vector<ContentType>& results)
+				// as above, also keeping this token's bin aggregate up to date with its heading
+				void updateForNewPositionAndHeading (const Vec3& p, const Vec3& f)
+				{
+					lqUpdateForNewLocationAndHeading (lq, &proxy, p.x, p.y, p.z, f.x, f.y, f.z);
+				}
+
+				// moves the token to the category's lists of its bin at the next position update
+				void setCategory (int category)
+				{
+					proxy.category = category;
+				}
+
+				// each bin is searched from the one added to it last, so the furthest from the front of its list comes first (numbered by
+				// orderInsertions(), in one pass over every bin rather than a walk up the list for each token)
+				int insertionOrder () const
+				{
+					return proxy.order;
+				}
+
+				// find all neighbors of the given categories within the given sphere (as center and radius)
+				void findNeighbors (const Vec3& center, const float radius, std::vector<ContentType>& results, unsigned int categories = PROXIMITY_ALL)
 				{
 					lqMapOverAllObjectsInLocality(	lq, 
 													center.x, center.y, center.z,
 													radius,
 													perNeighborCallBackFunction,
-													(void*)&results);
+													(void*)&results,
+													categories);
+				}
+
+				// find neighbors within the given sphere, taking whole bins beyond exactRadius from the lattice's running totals
+				void findNeighborsAggregated (const Vec3& center, const float exactRadius, const float radius, std::vector<ContentType>& results, std::vector<ProximityAggregate>& aggregates, unsigned int categories = PROXIMITY_ALL)
+				{
+					aggregatedQueryState state;
+					state.results		= &results;
+					state.aggregates	= &aggregates;
+
+					lqMapOverLocalityWithAggregates(lq, 
+													center.x, center.y, center.z,
+													radius, exactRadius,
+													perExactNeighborCallBackFunction,
+													perAggregateCallBackFunction,
+													(void*)&state,
+													categories);
 				}
 
             // called by LQ for each clientObject in the specified neighborhood:
@@ -200,6 +319,28 @@ template <class ContentType> class LQProximityDatabase : public AbstractProximit
 				results.push_back ((ContentType) clientObject);
             }
 
+			// result vectors for findNeighborsAggregated, passed through LQ as its client query state
+			struct aggregatedQueryState
+			{
+				std::vector<ContentType>*			results;
+				std::vector<ProximityAggregate>*	aggregates;
+			};
+
+			static void perExactNeighborCallBackFunction(void* clientObject, float /*distanceSquared*/, void* clientQueryState)
+			{
+				((aggregatedQueryState*) clientQueryState)->results->push_back ((ContentType) clientObject);
+			}
+
+			static void perAggregateCallBackFunction(const lqBinAggregate* bin, void* clientQueryState)
+			{
+				ProximityAggregate aggregate;
+				aggregate.count			= bin->count;
+				aggregate.positionSum	= Vec3(bin->px, bin->py, bin->pz);
+				aggregate.forwardSum	= Vec3(bin->fx, bin->fy, bin->fz);
+
+				((aggregatedQueryState*) clientQueryState)->aggregates->push_back (aggregate);
+			}
+
 			private:
 				lqClientProxy proxy;
 				lqDB* lq;
@@ -211,6 +352,11 @@ template <class ContentType> class LQProximityDatabase : public AbstractProximit
             return new tokenType(parentObject, *this);
         }
 
+		void orderInsertions()
+		{
+			lqNumberObjects(lq);
+		}
+
 		private:
 			lqDB* lq;
 };
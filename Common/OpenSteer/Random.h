@@ -0,0 +1,25 @@
+#ifndef _RANDOM_H_
+#define _RANDOM_H_
+
+#include "OpenSteer/Vec3.h"
+using namespace OpenSteer;
+
+// A stream of random numbers which depends only on a seed, the stream's number (e.g. an agent's) and how many have been drawn from it, so
+// it gives the same numbers whichever thread draws them and whatever the other streams are doing.  Each pair of numbers is a counter-based
+// hash (Philox 2x32, 10 rounds) of the stream number & draw count, keyed by the seed; there's no state to share and nothing to lock.
+class RandomStream
+{
+	public:
+		RandomStream(unsigned int seed = 0, unsigned int stream = 0);
+
+		unsigned int next();		// 32 random bits
+		float unit();				// in [0, 1)
+		Vec3 inUnitSphere();		// as RandomVectorInUnitRadiusSphere
+
+	private:
+		unsigned int key, stream, counter;
+		unsigned int spare;			// the second number of the last pair, if not used yet
+		bool hasSpare;
+};
+
+#endif
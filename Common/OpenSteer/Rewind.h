@@ -0,0 +1,80 @@
+#ifndef _REWIND_H_
+#define _REWIND_H_
+
+#include <vector>
+#include "OpenSteer/Trajectory.h"
+
+#define REWIND_BYTES		(16 * 1024 * 1024)		// default size of the ring that ticks are kept in
+#define REWIND_KEYFRAME		60						// default ticks from one keyframe to the next (a second of deterministic steps)
+#define REWIND_TICKS		(60 * 60 * 5)			// most ticks held, however much room there is (five minutes of deterministic steps)
+#define REWIND_ALIGN		16						// each tick's bytes in the ring start on a multiple of this
+
+// The last however many ticks of the simulation, for stepping back through, in a ring of fixed size.  Every REWIND_KEYFRAME ticks or so
+// (and whenever the agents change) a tick is a keyframe, kept as a checkpoint image of the whole crowd (see Checkpoint) along with every
+// agent quantised as in a recording; the ticks between keep only each agent's quantised change since the tick before (see TrajectoryCodec),
+// a few bytes apiece.  The oldest ticks make room for the newest, a keyframe and the ticks that follow from it at a time.
+//
+// A tick can be seen, as quantised, by decoding forward from its keyframe; going back to it exactly means restoring the keyframe's image
+// and simulating deterministically on from there (see BoidsPlugIn::rewind()).
+class RewindBuffer
+{
+	public:
+		RewindBuffer();
+
+		void configure(size_t bytes, int keyframeTicks);	// forgets everything held; 0 bytes for no buffer at all
+		void clear();										// forgets everything held
+		bool enabled() const				{ return capacity > 0; }
+		size_t bytes() const				{ return capacity; }
+		int keyframeTicks() const			{ return keyframeEvery; }
+
+		// one tick: begin, add each agent in turn, end; with a checkpoint image of the crowd as it is now if a keyframe's due
+		void beginTick();
+		void add(AgentHandle handle, const Vec3& position, const Vec3& forward);
+		bool keyframeDue() const;
+		void endTick(const std::vector<char>* image);
+
+		int ticks() const					{ return count; }
+		int firstTick() const				{ return (count > 0) ? entry(0).Tick : -1; }
+		int lastTick() const				{ return (count > 0) ? entry(count - 1).Tick : -1; }
+
+		bool keyframe(int tick, const char*& image, size_t& bytes, int& keyTick) const;		// the image of the last keyframe at or before a tick
+		bool view(int tick, std::vector<TrajectorySample>& agents);							// a tick's agents as quantised, without simulating
+		void truncate(int tick);			// forgets the ticks after, for the simulation to carry on from there
+
+		size_t usedBytes() const			{ return used; }		// of the ring
+		size_t reservedBytes() const;								// the ring, its index and the scratch for coding ticks, in all
+		int overflowed() const				{ return overflows; }	// ticks too big for the ring, each dropping everything held (since configured)
+
+	private:
+		class Entry
+		{
+			public:
+				int Tick;
+				size_t Offset, Bytes;		// in the ring (Bytes rounded up to REWIND_ALIGN)
+				size_t Image;				// bytes of checkpoint image ahead of the agents, for a keyframe (or 0)
+				unsigned int Agents;
+				bool Keyframe;
+		};
+
+		const Entry& entry(int i) const		{ return index[(first + i) % index.size()]; }
+		Entry& entry(int i)					{ return index[(first + i) % index.size()]; }
+
+		char* allocate(size_t bytes);		// room for a tick, evicting the oldest as needed; NULL if it couldn't ever fit
+		void evict();						// the oldest keyframe, and the ticks after it that depend on it
+
+		std::vector<char> storage;
+		char* ring;							// storage, aligned
+		size_t capacity, tail, used;		// the next tick goes at tail, if there's room
+
+		std::vector<Entry> index;			// of the ticks held, oldest first from first, round the end
+		int first, count;
+		int keyframeEvery;
+
+		int nextTick, sinceKeyframe;
+		int overflows;
+		bool changed;						// are this tick's agents not the last tick's?
+		std::vector<QuantisedAgent> current, previous, state;
+		std::vector<unsigned char> coded;
+};
+
+#endif
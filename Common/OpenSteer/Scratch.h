@@ -0,0 +1,64 @@
+#ifndef _SCRATCH_H_
+#define _SCRATCH_H_
+
+#include <vector>
+#include "OpenSteer/Proximity.h"
+#include "OpenSteer/Orca.h"
+
+#define SCRATCH_BLOCK		65536		// bytes the bump allocator takes from the heap at a time (or more, for a bigger request)
+#define SCRATCH_ALIGNMENT	16
+
+// A run of items an agent appended to its thread's scratch arena, found again by where it starts rather than by pointer, as the arena may
+// have grown (and moved) since.  Good until the arenas are emptied for the next frame.
+template <class T> class ArenaRange
+{
+	public:
+		ArenaRange()							{ items = NULL; first = 0; count = 0; }
+
+		void start(std::vector<T>& items)		{ this->items = &items; this->first = (int)items.size(); this->count = 0; }		// before appending...
+		void finish()							{ this->count = (int)items->size() - first; }									// ...and after
+		void clear()							{ this->count = 0; }
+
+		int size() const						{ return count; }
+		const T* begin() const					{ return (count > 0) ? &(*items)[first] : NULL; }
+		const T* end() const					{ return (count > 0) ? &(*items)[first] + count : NULL; }
+
+	private:
+		std::vector<T>* items;
+		int first, count;
+};
+
+// Each thread's scratch space for the agents it updates: the neighbours each one finds (kept for the rest of the frame, so that agents can
+// move after every agent has planned) and ORCA's working space.  Agents hold ArenaRanges into it rather than buffers of
+// their own, so there's no heap block per agent, and the same memory serves frame after frame.  Any other buffer needed only for the frame
+// comes from allocate(), a bump allocator which is rewound to its first block each frame; so once the arenas have grown to the biggest frame
+// yet, the frame loop doesn't go to the heap.
+class ScratchArena
+{
+	public:
+		ScratchArena();
+		~ScratchArena();
+
+		std::vector<AbstractVehicle*>	neighbours;
+		std::vector<ProximityAggregate>	aggregates;
+		std::vector<AbstractVehicle*>	contacts;
+		Orca							orca;
+
+		void* allocate(size_t bytes);		// until the next frame; never freed
+
+		static ScratchArena& Local();		// the calling thread's
+		static void NextFrame();			// empty every thread's, between frames (once no agent will read its ranges again)
+		static size_t ReservedBytes();		// by every thread's
+
+	private:
+		struct Block
+		{
+			char*	memory;
+			size_t	size;
+		};
+
+		std::vector<Block> blocks;			// kept from frame to frame
+		size_t current, used;				// the block being bumped through, and how far
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef _SCRIPT_H_
+#define _SCRIPT_H_
+
+#include <vector>
+#include "OpenSteer/Boid.h"
+
+#define SCRIPT_TICK			0.1f		// seconds per slot of the wake-up wheel
+#define SCRIPT_SLOTS		256			// slots round the wheel; longer waits go round it more than once
+#define SCRIPT_ARRIVAL		1.5f		// how near a goal counts as arriving at it
+#define SCRIPT_GOAL_WEIGHT	10.0f		// weight of the flow towards a goal being walked to
+
+// A scripted routine for one agent ("walk to the bar, wait 30 s, go to the dance floor"), suspended between steps at no cost to the frame.
+// There are no coroutines to be had in this compiler, so resume() is written as a switch on the line it last suspended at, in the manner of
+// Duff's device: between SCRIPT_BEGIN and SCRIPT_END, suspending with SCRIPT_WAIT or SCRIPT_WALK_TO.  Anything which must survive a
+// suspension has to be a member rather than a local.  Scripts are allocated from a pooled arena, so any number can be started and finished
+// without going to the heap.
+#define SCRIPT_BEGIN				switch (this->line) { case 0:
+#define SCRIPT_WAIT(seconds)		do { this->line = __LINE__; this->runner->wakeAfter(this, (seconds));	return; case __LINE__:; } while (0)
+#define SCRIPT_WALK_TO(goal)		do { this->line = __LINE__; this->runner->wakeOnArrival(this, (goal));	return; case __LINE__:; } while (0)
+#define SCRIPT_END					} this->line = -1;
+
+class ScriptRunner;
+
+class Script
+{
+	public:
+		Script();
+		virtual ~Script();
+
+		virtual void resume() = 0;			// run on to the next suspension, or the end
+		ScriptRunner* getRunner() const		{ return runner; }
+
+		static void* operator new(size_t size);
+		static void operator delete(void* p, size_t size);
+
+		static size_t ArenaBytes();			// reserved by the arena so far
+
+	protected:
+		Boid*			agent;
+		ScriptRunner*	runner;
+		int				line;				// where to resume, or -1 once finished
+
+	private:
+		friend class ScriptRunner;
+
+		Script*			next;				// in its slot of the wheel
+		unsigned int	rounds;				// of the wheel still to wait
+		int				goal;				// being walked to
+};
+
+// Drives every agent's script from the simulation tick.  Scripts waiting for a time are kept in a timing wheel, so each tick only touches
+// those due in it; scripts walking somewhere are checked for arrival; and those whose wait is over are resumed together in one batch.
+class ScriptRunner
+{
+	public:
+		ScriptRunner(FlowFieldCache* flowFields);
+		~ScriptRunner();
+
+		void start(Script* script, Boid* agent);	// the runner owns the script, which first runs on the next update
+		void cancel(Boid* agent);					// stop the agent's script, before the agent goes
+		void update(const float elapsedTime);
+
+		// for the SCRIPT_ macros
+		void wakeAfter(Script* script, float seconds);
+		void wakeOnArrival(Script* script, int goal);
+
+		int scriptCount() const						{ return scripts; }
+		int resumedCount() const					{ return resumed; }		// in the last update
+
+	private:
+		void finish(Script* script);
+
+		FlowFieldCache* flowFields;
+
+		Script* wheel[SCRIPT_SLOTS];
+		unsigned int tick;							// the wheel's current slot, unwrapped
+		float clock;								// time into the current tick
+
+		std::vector<Script*> walking;
+		std::vector<Script*> woken;					// the batch to resume this update
+
+		int scripts, resumed;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _SPAWN_H_
+#define _SPAWN_H_
+
+#include <vector>
+#include "OpenSteer/Vec3.h"
+#include "OpenSteer/Random.h"
+#include "OpenSteer/DistanceField.h"
+using namespace OpenSteer;
+
+#define SPAWN_ROUNDS		12			// most darts thrown at each empty cell of the Poisson-disk grid (fewer once there are enough)
+#define SPAWN_DENSITY		0.45f		// boids per spacing squared to spread out to (a maximal sampling holds about 0.7)
+#define SPAWN_RETRIES		8			// times the spacing is closed up, if there still isn't room for everyone
+#define SPAWN_SHRINK		0.85f		// by this much each time
+#define SPAWN_MARGIN		0.1f		// added to a body's width for the spacing of a crowd spawned at the venue
+#define SPAWN_SORT_CELL		4			// positions to a cell, on average, when sorting them to be inserted
+
+// Where BoidsPlugIn::spawn() puts the boids it makes
+class SpawnDistribution
+{
+	public:
+		virtual ~SpawnDistribution() {}
+		virtual void place(int count, RandomStream& random, std::vector<Vec3>& positions) const = 0;		// appends count positions
+
+		// Into rows of cells over the positions' extent, X major as the proximity database's bins are, by a counting sort.  Boids made in
+		// this order go into the database bin after bin, rather than each to a bin (and a token at its head) somewhere else in memory.
+		static void SortByCell(std::vector<Vec3>& positions);
+};
+
+// Anywhere on the floor of a rectangle, at random
+class UniformSpawn : public SpawnDistribution
+{
+	public:
+		UniformSpawn(const Vec3& center, float halfLength, float halfWidth);
+		void place(int count, RandomStream& random, std::vector<Vec3>& positions) const;
+
+	private:
+		Vec3 center;
+		float halfLength, halfWidth;
+};
+
+// Blue noise over the floor of a rectangle: no two boids nearer than the spacing (clear of the walls, and of any positions already taken),
+// so a crowd starts settled rather than bursting apart.  Darts are thrown at a grid of cells small enough to hold one sample each, in
+// rounds; within a round the cells go in nine phases, cells of a phase three apart so none of them can see another's dart, and each phase is
+// spread over the worker threads.  Every cell draws from its own random stream, so the result depends only on the seed, not on the threads.
+// The spacing asked is a least: a rectangle with room to spare is spread over evenly, and one that can't hold everyone is closed up until it
+// can (any left over after that are put down at random).
+class PoissonDiskSpawn : public SpawnDistribution
+{
+	public:
+		PoissonDiskSpawn(const Vec3& center, float halfLength, float halfWidth, float spacing, const DistanceField* walls = NULL, float clearance = 0.0f);
+		void place(int count, RandomStream& random, std::vector<Vec3>& positions) const;
+
+		void keepClearOf(const std::vector<Vec3>* occupied)		{ this->occupied = occupied; }		// e.g. the flock already spawned
+
+	private:
+		class Sampler;
+		static void ThrowDarts(int begin, int end, void* sampler);
+
+		Vec3 center;
+		float halfLength, halfWidth;
+		float spacing;
+		const DistanceField* walls;
+		float clearance;
+		const std::vector<Vec3>* occupied;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef _THINK_H_
+#define _THINK_H_
+
+#include <string>
+#include <vector>
+
+// Staggers decisions which needn't be made every frame (obstacle look-ahead, flow lookups, goal choice...).  Each behaviour is registered with
+// how many frames apart it should decide, and each agent holds a think slot, so that every frame only the agents whose slot comes round
+// think - about count / period of them for each behaviour, however the agents are spread - and the rest reuse their last decision.
+class ThinkScheduler
+{
+	public:
+		ThinkScheduler();
+
+		int addBehaviour(const char* name, int period);		// returns the behaviour's id for due()
+		int assignSlot();									// for a new agent
+
+		void tick();										// once per frame, before the agents update
+		void restart();										// from the first frame & slot again, e.g. for a seeded run
+		void resume(unsigned int frame, int nextSlot);		// from where another run was, e.g. restoring a checkpoint
+		unsigned int currentFrame() const					{ return frame; }
+		int slotsAssigned() const							{ return nextSlot; }
+		bool due(int behaviour, int slot) const				{ return ((frame + slot) % periods[behaviour]) == 0; }
+
+		int behaviourCount() const							{ return (int)periods.size(); }
+		const char* behaviourName(int behaviour) const		{ return names[behaviour].c_str(); }
+		int behaviourPeriod(int behaviour) const			{ return periods[behaviour]; }
+
+	private:
+		unsigned int frame;
+		int nextSlot;
+		int cycle;						// least common multiple of the periods, that the slots are handed out modulo
+
+		std::vector<std::string> names;
+		std::vector<unsigned int> periods;
+};
+
+#endif
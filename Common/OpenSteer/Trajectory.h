@@ -0,0 +1,231 @@
+#ifndef _TRAJECTORY_H_
+#define _TRAJECTORY_H_
+
+#include <windows.h>
+#include <fstream>
+#include <vector>
+#include "OpenSteer/Vec3.h"
+#include "OpenSteer/Handle.h"
+#include "../Benchmark.h"
+using namespace OpenSteer;
+
+#define TRAJECTORY_VERSION			2
+#define TRAJECTORY_KEYFRAME			60					// most frames to a chunk, each starting with a keyframe to decode the rest from
+#define TRAJECTORY_POSITION_STEP	(1.0f / 512.0f)		// metres to a unit of quantised position (about 2mm)
+#define TRAJECTORY_HEADING_STEPS	65536				// units of quantised heading to a turn
+#define TRAJECTORY_INDEX_RESERVE	4096				// chunks indexed before the index has to grow (over an hour at 60 frames a second)
+#define TRAJECTORY_CAMERA			16					// floats to a frame's camera, its view-projection matrix
+#define REPLAY_AHEAD				4					// frames a replay decodes ahead of the one being shown
+
+struct TRAJECTORY_HEADER
+{
+	char			Magic[4];			// "OVCT"
+	unsigned int	Version;
+	float			PositionStep;
+	unsigned int	Keyframe;
+};
+
+struct TRAJECTORY_CHUNK					// ahead of each chunk's frames, each of which starts with a byte for whether the camera follows
+{
+	unsigned int	FirstFrame;
+	unsigned int	Frames;
+	unsigned int	Agents;
+	unsigned int	Bytes;
+};
+
+struct TRAJECTORY_INDEX					// one per chunk, after the last
+{
+	unsigned __int64	Offset;			// of the chunk's TRAJECTORY_CHUNK, from the start of the file
+	unsigned int		FirstFrame;
+	unsigned int		Agents;
+};
+
+struct TRAJECTORY_FOOTER				// at the very end
+{
+	unsigned __int64	IndexOffset;
+	unsigned int		Chunks;
+	unsigned int		Frames;
+	char				Magic[4];		// "OVCI"
+	unsigned int		Reserved;
+};
+
+// One agent of a frame, as recorded: its position & heading on the floor, to the recording's precision
+class TrajectorySample
+{
+	public:
+		AgentHandle Handle;
+		Vec3 Position;
+		Vec3 Forward;
+};
+
+// An agent quantised: position in units of TRAJECTORY_POSITION_STEP, heading as an angle about the vertical
+class QuantisedAgent
+{
+	public:
+		AgentHandle Handle;
+		int X, Y, Z;
+		int Heading;					// 0 to TRAJECTORY_HEADING_STEPS - 1
+};
+
+// How a frame's agents are coded, by recordings & by the rewind buffer: quantised, then either whole (a keyframe) or as each agent's change
+// since the frame before (which must have had the same agents, in the same order), zigzag & varint coded
+class TrajectoryCodec
+{
+	public:
+		static void Quantise(AgentHandle handle, const Vec3& position, const Vec3& forward, QuantisedAgent& agent);
+
+		static void PutKeyframe(std::vector<unsigned char>& bytes, const std::vector<QuantisedAgent>& agents);
+		static void PutChanges(std::vector<unsigned char>& bytes, const std::vector<QuantisedAgent>& agents, const std::vector<QuantisedAgent>& previous);
+
+		// (as many agents as there are in the vector, from p on; false if the bytes run out first)
+		static bool GetKeyframe(const unsigned char*& p, const unsigned char* end, std::vector<QuantisedAgent>& agents);
+		static bool GetChanges(const unsigned char*& p, const unsigned char* end, std::vector<QuantisedAgent>& agents);
+};
+
+// Records where every agent is, every frame, compactly enough for long runs.  Each agent's position & heading is quantised and, but for the
+// first frame of each chunk, written as the change since the last frame, zigzag & varint coded, so an agent that hardly moves takes about
+// four bytes a frame.  The camera, if given, is kept with each frame as it was, so that a replay can be seen (and culled) the same way.
+// A chunk ends after TRAJECTORY_KEYFRAME frames, or sooner when the agents change (spawned, despawned or reordered), and is handed to a
+// writer thread; the file ends with an index of the chunks, so that a reader can seek to any frame by decoding no more than one chunk.
+// Frames are encoded on the simulation thread (how long that takes is kept, see encodeSeconds()), so the writer's I/O is all that's off it.
+class TrajectoryRecorder
+{
+	public:
+		TrajectoryRecorder();
+		~TrajectoryRecorder();			// closes the recording, if open
+
+		bool open(const char* filename);
+		void close();					// waits for the writer to finish, then writes the index
+		bool recording() const			{ return (thread != NULL) && !failed; }
+		bool writeFailed() const		{ return (thread != NULL) && failed; }		// the writer stopped, short of the frames given it; close() the recording
+
+		// one frame: begin, add each agent in turn, end
+		void camera(const float viewProjection[TRAJECTORY_CAMERA]);		// (kept for every frame from then on)
+		void beginFrame();
+		void add(AgentHandle handle, const Vec3& position, const Vec3& forward);
+		void endFrame();
+
+		int frames() const				{ return frameCount; }
+		double encodeSeconds() const	{ return encoding; }		// spent encoding frames on the simulation thread, in all
+		unsigned __int64 bytes() const	{ return encoded; }			// encoded, in all
+
+	private:
+		class Chunk
+		{
+			public:
+				TRAJECTORY_CHUNK			header;
+				std::vector<unsigned char>	bytes;
+		};
+
+		void submit();					// the chunk being encoded, to the writer
+		void write(Chunk* chunk);		// on the writer thread
+
+		static unsigned __stdcall Writer(void* recorder);
+
+		std::ofstream file;
+
+		std::vector<QuantisedAgent> current, previous;
+		bool changed;					// are this frame's agents not the last frame's?
+		float viewProjection[TRAJECTORY_CAMERA];
+		bool viewed;					// has a camera been given?
+		Chunk* chunk;					// being encoded, or NULL between chunks
+		int frameCount;
+
+		Benchmark frameTimer;			// (no log, just the timing)
+		double encoding;
+		unsigned __int64 encoded;
+
+		HANDLE				thread, wake;
+		CRITICAL_SECTION	lock;		// guards pending, spare & quit
+		std::vector<Chunk*>	pending;	// for the writer, oldest first
+		std::vector<Chunk*>	spare;		// written, for reuse
+		bool				quit;
+		volatile bool		failed;		// set by the writer when a write fails, after which it writes nothing more
+
+		std::vector<TRAJECTORY_INDEX> index;		// of the chunks written, kept by the writer
+		unsigned __int64 offset;					// where the writer's next chunk goes
+};
+
+// Reads a recording back, frame by frame or from anywhere in it, decoding straight from a view of the file mapped into memory.  Reading
+// frames in order decodes each once; reading elsewhere decodes from the start of the frame's chunk.
+class TrajectoryReader
+{
+	public:
+		TrajectoryReader();
+		~TrajectoryReader();
+
+		bool open(const char* filename);		// fails if missing, another version or not closed properly
+		void close();
+
+		int frames() const						{ return frameCount; }
+		bool read(int frame, std::vector<TrajectorySample>& agents);
+		const float* camera() const				{ return viewed ? viewProjection : NULL; }		// of the frame last read, if recorded
+
+		static void Decode(const QuantisedAgent& quantised, float positionStep, TrajectorySample& sample);
+
+	private:
+		bool load(int chunk);
+
+		HANDLE file, mapping;
+		const unsigned char* view;
+		unsigned __int64 size;
+
+		TRAJECTORY_HEADER header;
+		std::vector<TRAJECTORY_INDEX> index;
+		int frameCount;
+
+		int chunk;								// loaded, or -1
+		TRAJECTORY_CHUNK chunkHeader;
+		const unsigned char* cursor;			// in the view, at the next frame to decode
+		const unsigned char* chunkEnd;
+		int decoded;							// the frame state holds, or -1
+		std::vector<QuantisedAgent> state;
+		float viewProjection[TRAJECTORY_CAMERA];
+		bool viewed;
+};
+
+// One frame of a replay, decoded
+class ReplayFrame
+{
+	public:
+		int Frame;
+		std::vector<TrajectorySample> Agents;
+		bool Camera;							// was it recorded?
+		float ViewProjection[TRAJECTORY_CAMERA];
+};
+
+// Plays a recording back from start to finish, a frame at a time and as fast as it's asked for them, for benchmarking what's done with
+// the agents afterwards (culling, packing & drawing) apart from the simulation that moved them.  A worker thread decodes up to REPLAY_AHEAD
+// frames ahead into a ring, so a frame is usually waiting when it's wanted; how long it wasn't is kept.
+class TrajectoryReplay
+{
+	public:
+		TrajectoryReplay();
+		~TrajectoryReplay();					// stops the replay, if any
+
+		bool open(const char* filename);
+		void close();
+		bool replaying() const					{ return thread != NULL; }
+
+		int frames() const						{ return reader.frames(); }
+		const ReplayFrame* next();				// the next frame, once decoded, good until the next call; NULL after the last
+		double waitSeconds() const				{ return waiting; }		// spent in next(), waiting for the decoder
+
+	private:
+		static unsigned __stdcall Decoder(void* replay);
+
+		TrajectoryReader reader;
+		ReplayFrame ahead[REPLAY_AHEAD];		// frame n in n % REPLAY_AHEAD
+
+		HANDLE				thread, wake, ready;	// wake the decoder when a frame's been finished with, ready when it's decoded one
+		CRITICAL_SECTION	lock;					// guards decodedCount, takenCount, finished & quit
+		int					decodedCount;			// frames decoded...
+		int					takenCount;				// ...and finished with
+		bool				finished, quit;
+		bool				holding;				// is a frame out with the caller?
+
+		Benchmark waitTimer;
+		double waiting;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef _WALL_FILE_H_
+#define _WALL_FILE_H_
+
+#include <vector>
+#include "OpenSteer/Vec3.h"
+using namespace OpenSteer;
+
+#define VENUE_WALLS			"Testbed.walls"		// walls sliced from Testbed.x, written by the Testbed on load & read by the Boids plugin
+#define VENUE_WALL_HEIGHT	1.0f				// height above the floor at which the venue is sliced
+
+// One wall on the XZ plane
+class WallSegment
+{
+	public:
+		WallSegment()
+		{
+		}
+		WallSegment(const Vec3& Start, const Vec3& End)
+		{
+			this->Start	= Start;
+			this->End	= End;
+		}
+
+		Vec3 Start, End;
+};
+
+// Walls are taken from venue geometry by slicing its triangles with a horizontal plane, then simplified by merging the collinear pieces left 
+// by neighbouring triangles (and the duplicates left by double-sided ones).  The result is stored as a compact binary file: a small header 
+// followed by four floats (start X & Z, end X & Z) per wall, so the simulation can load it without touching the mesh.  
+void SliceTriangleAtHeight(const Vec3& a, const Vec3& b, const Vec3& c, float height, std::vector<WallSegment>& walls);
+void SimplifyWalls(std::vector<WallSegment>& walls, float tolerance);
+
+bool SaveWallFile(const char* filename, float height, const std::vector<WallSegment>& walls);
+bool LoadWallFile(const char* filename, float height, std::vector<WallSegment>& walls);		// fails if missing, or sliced at another height
+
+#endif
@@ -83,6 +83,9 @@ extern "C"
 /*                       Data types use by LQ                         */
 /*                                                                    */
 /* ------------------------------------------------------------------ */
+#define LQ_CATEGORIES		8			// each bin keeps its objects in a separate list per category, so queries can skip whole categories
+#define LQ_ALL_CATEGORIES	0xFFu		// query mask with a bit set for every category
+
 typedef struct lqInternalDB lqDB;			// This structure represents the spatial database.  Typically one of these would be created (by a call to lqCreateDatabase) for a given application.
 
 // This structure is a proxy for (and contains a pointer to) a client (application) object in the spatial database.  One of these exists for each 
@@ -93,11 +96,26 @@ typedef struct lqClientProxy
     struct lqClientProxy*  next;		// next object in this bin, or NULL
     struct lqClientProxy** bin;			// bin ID (pointer to pointer to bin contents list)
 
+    struct lqBinAggregate* aggregate;	// running totals of the bin this object is in, or NULL
+
     void* object;						// pointer to client object
 
+    int category;						// 0 to LQ_CATEGORIES - 1; a change takes effect at the next location update
+    int order;							// place in its bin's list as of the last lqNumberObjects, the head highest
+
     float x, y, z;						// the object's location ("key point") used for spatial sorting
+    float fx, fy, fz;					// the object's heading, summed into its bin's aggregate
 } lqClientProxy;
 
+// Running totals for the contents of one bin, kept up to date as client objects enter, leave and move within it.  Behaviours which only need 
+// the sum of their neighbours' positions or headings (e.g. cohesion and alignment) can use a distant bin's totals in place of its contents.
+typedef struct lqBinAggregate
+{
+    int count;							// number of client objects in the bin
+    float px, py, pz;					// sum of their locations
+    float fx, fy, fz;					// sum of their headings
+} lqBinAggregate;
+
 /* ------------------------------------------------------------------ */
 /*                                                                    */
 /*                            Basic API                               */
@@ -115,6 +133,7 @@ lqDB* lqCreateDatabase(	float originx, float originy, float originz,
 						int   divx,    int   divy,    int   divz);
 void lqDeleteDatabase(lqDB*);																// Deallocates the LQ database
 void lqUpdateForNewLocation (lqDB* lq, lqClientProxy* object, float x, float y, float z);	// Call for each client object every time its location changes.  For example, in an animation application, this would be called each frame for every moving object.
+void lqUpdateForNewLocationAndHeading (lqDB* lq, lqClientProxy* object, float x, float y, float z, float fx, float fy, float fz);		// As above, also recording the object's heading for its bin's aggregate.
 
 // Apply an application-specific function to all objects in a certain locality.  The locality is specified as a sphere with a given center and 
 // radius.  All objects whose location (key-point) is within this sphere are identified and the function is applied to them.  The 
@@ -126,8 +145,19 @@ void lqUpdateForNewLocation (lqDB* lq, lqClientProxy* object, float x, float y,
 // This routine uses the LQ database to quickly reject any objects in bins which do not overlap with the sphere of interest.  Incremental
 // calculation of index values is used to efficiently traverse the bins of interest.
 
+// Only objects of the categories whose bits are set in the categories mask are considered (LQ_ALL_CATEGORIES for all of them); the lists of the 
+// others aren't touched.
 typedef void (*lqCallBackFunction) (void* clientObject, float distanceSquared, void* clientQueryState);		// type for a pointer to a function used to map over client objects */
-void lqMapOverAllObjectsInLocality(lqDB* lq, float x, float y, float z, float radius, lqCallBackFunction func, void* clientQueryState);
+void lqMapOverAllObjectsInLocality(lqDB* lq, float x, float y, float z, float radius, lqCallBackFunction func, void* clientQueryState, unsigned int categories);
+
+// As lqMapOverAllObjectsInLocality, but only bins which come within exactRadius of the centre are traversed object by object.  Every other 
+// occupied bin which overlaps the locality sphere is instead passed whole to aggregateFunc, which receives the bin's lqBinAggregate and the 
+// client query state.  The caller decides what to do with an aggregate (typically test its centre of mass against the locality), so the cost 
+// of a query grows with the number of bins it covers rather than the number of objects in them.  Aggregates are kept per category, and one is 
+// reported for each category in the mask with objects in the bin.
+typedef void (*lqAggregateCallBackFunction) (const lqBinAggregate* aggregate, void* clientQueryState);
+void lqMapOverLocalityWithAggregates(lqDB* lq, float x, float y, float z, float radius, float exactRadius, 
+									 lqCallBackFunction func, lqAggregateCallBackFunction aggregateFunc, void* clientQueryState, unsigned int categories);
 
 /* ------------------------------------------------------------------ */
 /*                                                                    */
@@ -139,19 +169,21 @@ void lqMapOverAllObjectsInLocality(lqDB* lq, float x, float y, float z, float ra
 // consideration (or it can be NULL).  This is useful when looking for the nearest neighbor of an object in the database, since otherwise it would 
 // be its own nearest neighbor. The function returns a void* pointer to the nearest object, or NULL if none is found.
 
-void* lqFindNearestNeighborWithinRadius(lqDB* lq, float x, float y, float z, float radius, void* ignoreObject);
-void lqAddToBin(lqClientProxy* object, lqClientProxy** bin);	// Adds a given client object to a given bin, linking it into the bin contents list.
-void lqRemoveFromBin(lqClientProxy* object);					// Removes a given client object from its current bin, unlinking it from the bin contents list.
+void* lqFindNearestNeighborWithinRadius(lqDB* lq, float x, float y, float z, float radius, void* ignoreObject, unsigned int categories);
+void lqAddToBin(lqClientProxy* object, lqClientProxy** bin, lqBinAggregate* aggregate);	// Adds a given client object to a given bin, linking it into the bin contents list and adding it to the bin's aggregate.
+void lqRemoveFromBin(lqClientProxy* object);											// Removes a given client object from its current bin, unlinking it from the bin contents list and its aggregate.
 
 // Given an LQ database object and the nine basic parameters: fill in the object's slots, allocate the bin array, and initialize its contents.  
 // Normally the application does NOT call this directly, it is called by lqCreateDatabase.  */
 void lqInitDatabase(lqDB* lq, float originx, float originy, float originz, float sizex, float sizey, float sizez, int divx, int divy, int divz);
 
-// Find the bin ID for a location in space.  The location is given in terms of its XYZ coordinates.  The bin ID is a pointer to a pointer to the 
-// bin contents list.
-lqClientProxy** lqBinForLocation(lqDB* lq, float x, float z);
+// Find the bin ID for a location in space and a category of object.  The location is given in terms of its XYZ coordinates.  The bin ID is a 
+// pointer to a pointer to the bin's contents list for that category.
+lqClientProxy** lqBinForLocation(lqDB* lq, float x, float z, int category);
+lqBinAggregate* lqAggregateForBin(lqDB* lq, lqClientProxy** bin);							// Find the running totals which belong to a given bin ID.
 void lqMapOverAllObjects(lqDB* lq, lqCallBackFunction func, void* clientQueryState);		// Apply a user-supplied function to all objects in the database, regardless of locality (cf lqMapOverAllObjectsInLocality)
 void lqRemoveAllObjects(lqDB* lq);															// Removes (all proxies for) all objects from all bins
+void lqNumberObjects(lqDB* lq);																// Sets every object's order, in one pass down every bin's list
 
 #ifdef __cplusplus
 }
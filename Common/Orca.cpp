@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <math.h>
+#include "OpenSteer/Orca.h"
+
+#define ORCA_EPSILON	0.00001f
+
+static inline float det(float ax, float az, float bx, float bz)
+{
+	return (ax * bz) - (az * bx);
+}
+
+OpenSteer::Vec3 Orca::solve(const AbstractVehicle& vehicle, const Vec3& preferred, AbstractVehicle* const* first, AbstractVehicle* const* last, float maxSpeed, float timeStep)
+{
+	const Vec3 velocity			= vehicle._forward * vehicle._speed;
+	const float invTimeHorizon	= 1.0f / ORCA_TIME_HORIZON;
+
+	// the nearest few neighbours within reach
+	nearest.clear();
+	for (AbstractVehicle* const* i = first ; i != last ; i++)
+	{
+		const float distanceSquared = ((**i).Position - vehicle.Position).lengthSquared();
+
+		if ((*i != &vehicle) && (distanceSquared < (ORCA_RADIUS * ORCA_RADIUS)))
+			nearest.push_back(std::pair<float, AbstractVehicle*>(distanceSquared, *i));
+	}
+
+	if (nearest.size() > ORCA_NEIGHBOURS)
+	{
+		std::nth_element(nearest.begin(), nearest.begin() + ORCA_NEIGHBOURS, nearest.end());
+		nearest.resize(ORCA_NEIGHBOURS);
+	}
+
+	// one half-plane of permitted velocities for each
+	lines.clear();
+	for (size_t i = 0 ; i < nearest.size() ; i++)
+	{
+		const AbstractVehicle& other	= *nearest[i].second;
+		const Vec3 otherVelocity		= other._forward * other._speed;
+
+		const float relPosX			= other.Position.x - vehicle.Position.x;
+		const float relPosZ			= other.Position.z - vehicle.Position.z;
+		const float relVelX			= velocity.x - otherVelocity.x;
+		const float relVelZ			= velocity.z - otherVelocity.z;
+		const float distSq			= nearest[i].first;
+		const float combinedRadius	= vehicle._radius + other._radius;
+		const float combinedRadiusSq	= combinedRadius * combinedRadius;
+
+		Line line;
+		float ux, uz;
+
+		if (distSq > combinedRadiusSq)
+		{
+			// no collision yet: vector from the cutoff circle's centre to the relative velocity
+			const float wx			= relVelX - (invTimeHorizon * relPosX);
+			const float wz			= relVelZ - (invTimeHorizon * relPosZ);
+			const float wLengthSq	= (wx * wx) + (wz * wz);
+			const float dotProduct	= (wx * relPosX) + (wz * relPosZ);
+
+			if ((dotProduct < 0.0f) && ((dotProduct * dotProduct) > (combinedRadiusSq * wLengthSq)))
+			{
+				// project on the cutoff circle
+				const float wLength	= sqrt(wLengthSq);
+				const float unitWx	= wx / wLength;
+				const float unitWz	= wz / wLength;
+
+				line.dx	= unitWz;
+				line.dz	= -unitWx;
+				ux		= ((combinedRadius * invTimeHorizon) - wLength) * unitWx;
+				uz		= ((combinedRadius * invTimeHorizon) - wLength) * unitWz;
+			}
+			else
+			{
+				// project on the nearer leg of the velocity obstacle
+				const float leg = sqrt(distSq - combinedRadiusSq);
+
+				if (det(relPosX, relPosZ, wx, wz) > 0.0f)
+				{
+					line.dx = ((relPosX * leg) - (relPosZ * combinedRadius)) / distSq;
+					line.dz = ((relPosX * combinedRadius) + (relPosZ * leg)) / distSq;
+				}
+				else
+				{
+					line.dx = -((relPosX * leg) + (relPosZ * combinedRadius)) / distSq;
+					line.dz = -((-relPosX * combinedRadius) + (relPosZ * leg)) / distSq;
+				}
+
+				const float dotProduct2 = (relVelX * line.dx) + (relVelZ * line.dz);
+				ux = (dotProduct2 * line.dx) - relVelX;
+				uz = (dotProduct2 * line.dz) - relVelZ;
+			}
+		}
+		else
+		{
+			// already overlapping: separate within this time step
+			const float invTimeStep	= 1.0f / timeStep;
+			const float wx			= relVelX - (invTimeStep * relPosX);
+			const float wz			= relVelZ - (invTimeStep * relPosZ);
+			const float wLength		= std::max((float)sqrt((wx * wx) + (wz * wz)), ORCA_EPSILON);
+			const float unitWx		= wx / wLength;
+			const float unitWz		= wz / wLength;
+
+			line.dx	= unitWz;
+			line.dz	= -unitWx;
+			ux		= ((combinedRadius * invTimeStep) - wLength) * unitWx;
+			uz		= ((combinedRadius * invTimeStep) - wLength) * unitWz;
+		}
+
+		// take half the responsibility for avoiding the collision
+		line.px = velocity.x + (0.5f * ux);
+		line.pz = velocity.z + (0.5f * uz);
+		lines.push_back(line);
+	}
+
+	float resultX, resultZ;
+	const size_t failed = linearProgram2(lines, maxSpeed, preferred.x, preferred.z, false, resultX, resultZ);
+
+	if (failed < lines.size())		// infeasible: find the velocity that least violates the remaining lines
+		linearProgram3(failed, maxSpeed, resultX, resultZ);
+
+	return Vec3(resultX, 0.0f, resultZ);
+}
+
+// the point on line lineNo, within the speed circle and permitted by all earlier lines, nearest the optimum (or furthest in its direction)
+bool Orca::linearProgram1(const std::vector<Line>& lines, size_t lineNo, float radius, float optX, float optZ, bool directionOpt, float& resultX, float& resultZ) const
+{
+	const Line& line			= lines[lineNo];
+	const float dotProduct		= (line.px * line.dx) + (line.pz * line.dz);
+	const float discriminant	= (dotProduct * dotProduct) + (radius * radius) - ((line.px * line.px) + (line.pz * line.pz));
+
+	if (discriminant < 0.0f)		// the speed circle rules out the whole line
+		return false;
+
+	const float sqrtDiscriminant = sqrt(discriminant);
+	float tLeft		= -dotProduct - sqrtDiscriminant;
+	float tRight	= -dotProduct + sqrtDiscriminant;
+
+	for (size_t i = 0 ; i < lineNo ; i++)
+	{
+		const float denominator	= det(line.dx, line.dz, lines[i].dx, lines[i].dz);
+		const float numerator	= det(lines[i].dx, lines[i].dz, line.px - lines[i].px, line.pz - lines[i].pz);
+
+		if (fabs(denominator) <= ORCA_EPSILON)		// parallel lines
+		{
+			if (numerator < 0.0f)
+				return false;
+			continue;
+		}
+
+		const float t = numerator / denominator;
+
+		if (denominator >= 0.0f)
+			tRight	= std::min(tRight, t);
+		else
+			tLeft	= std::max(tLeft, t);
+
+		if (tLeft > tRight)
+			return false;
+	}
+
+	float t;
+	if (directionOpt)
+		t = (((optX * line.dx) + (optZ * line.dz)) > 0.0f) ? tRight : tLeft;
+	else
+		t = std::max(tLeft, std::min((line.dx * (optX - line.px)) + (line.dz * (optZ - line.pz)), tRight));
+
+	resultX = line.px + (t * line.dx);
+	resultZ = line.pz + (t * line.dz);
+	return true;
+}
+
+// the velocity within the speed circle, permitted by every line, nearest the optimum; returns the number of lines satisfied before failing
+size_t Orca::linearProgram2(const std::vector<Line>& lines, float radius, float optX, float optZ, bool directionOpt, float& resultX, float& resultZ) const
+{
+	const float optLengthSq = (optX * optX) + (optZ * optZ);
+
+	if (directionOpt)
+	{
+		resultX = optX * radius;
+		resultZ = optZ * radius;
+	}
+	else if (optLengthSq > (radius * radius))
+	{
+		resultX = (optX / sqrt(optLengthSq)) * radius;
+		resultZ = (optZ / sqrt(optLengthSq)) * radius;
+	}
+	else
+	{
+		resultX = optX;
+		resultZ = optZ;
+	}
+
+	for (size_t i = 0 ; i < lines.size() ; i++)
+	{
+		if (det(lines[i].dx, lines[i].dz, lines[i].px - resultX, lines[i].pz - resultZ) > 0.0f)		// result breaks this line
+		{
+			const float tempX = resultX;
+			const float tempZ = resultZ;
+
+			if (!linearProgram1(lines, i, radius, optX, optZ, directionOpt, resultX, resultZ))
+			{
+				resultX = tempX;
+				resultZ = tempZ;
+				return i;
+			}
+		}
+	}
+
+	return lines.size();
+}
+
+// when no velocity satisfies every line, the one that minimises the largest violation of them
+void Orca::linearProgram3(size_t beginLine, float radius, float& resultX, float& resultZ)
+{
+	float distance = 0.0f;
+
+	for (size_t i = beginLine ; i < lines.size() ; i++)
+	{
+		if (det(lines[i].dx, lines[i].dz, lines[i].px - resultX, lines[i].pz - resultZ) <= distance)
+			continue;
+
+		projected.clear();
+
+		for (size_t j = 0 ; j < i ; j++)
+		{
+			Line line;
+			const float determinant = det(lines[i].dx, lines[i].dz, lines[j].dx, lines[j].dz);
+
+			if (fabs(determinant) <= ORCA_EPSILON)
+			{
+				if (((lines[i].dx * lines[j].dx) + (lines[i].dz * lines[j].dz)) > 0.0f)		// same direction
+					continue;
+
+				line.px = 0.5f * (lines[i].px + lines[j].px);
+				line.pz = 0.5f * (lines[i].pz + lines[j].pz);
+			}
+			else
+			{
+				const float t = det(lines[j].dx, lines[j].dz, lines[i].px - lines[j].px, lines[i].pz - lines[j].pz) / determinant;
+				line.px = lines[i].px + (t * lines[i].dx);
+				line.pz = lines[i].pz + (t * lines[i].dz);
+			}
+
+			const float dx		= lines[j].dx - lines[i].dx;
+			const float dz		= lines[j].dz - lines[i].dz;
+			const float length	= sqrt((dx * dx) + (dz * dz));
+			line.dx = dx / length;
+			line.dz = dz / length;
+
+			projected.push_back(line);
+		}
+
+		const float tempX = resultX;
+		const float tempZ = resultZ;
+
+		if (linearProgram2(projected, radius, -lines[i].dz, lines[i].dx, true, resultX, resultZ) < projected.size())
+		{
+			// only fails through rounding, as it's already in the permitted region of this linear program
+			resultX = tempX;
+			resultZ = tempZ;
+		}
+
+		distance = det(lines[i].dx, lines[i].dz, lines[i].px - resultX, lines[i].pz - resultZ);
+	}
+}
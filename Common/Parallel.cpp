@@ -0,0 +1,140 @@
+#include <float.h>
+#include <process.h>
+#include "Parallel.h"
+#include "Allocations.h"
+
+#ifdef _M_X64
+	#define FP_CONTROLS		_MCW_RC					// (x64 has no x87 precision control to copy)
+#else
+	#define FP_CONTROLS		(_MCW_PC | _MCW_RC)
+#endif
+
+static WorkerPool& Pool()
+{
+	static WorkerPool pool;			// started on first use
+	return pool;
+}
+
+void ParallelFor(int count, ParallelBody body, void* context)
+{
+	Pool().run(count, body, context);
+}
+
+int ParallelThreads()
+{
+	return Pool().threads();
+}
+
+void ParallelLimit(int threads)
+{
+	Pool().limit(threads);
+}
+
+WorkerPool::WorkerPool()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+
+	const int extra = max(0, (int)info.dwNumberOfProcessors - 1);
+
+	this->start		= CreateSemaphore(NULL, 0, max(1, extra), NULL);
+	this->done		= CreateEvent(NULL, FALSE, FALSE, NULL);
+	this->quit		= false;
+	this->body		= NULL;
+	this->context	= NULL;
+	this->count		= 0;
+	this->chunk		= 1;
+	this->nextChunk	= 0;
+	this->busy		= 0;
+	this->controlWord	= 0;
+
+	// (the workers' allocations are their callers', to an AllocationWatch)
+	for (int i = 0 ; i < extra ; i++)
+	{
+		unsigned int id = 0;
+		workers.push_back((HANDLE)_beginthreadex(NULL, 0, Worker, this, 0, &id));
+		AllocationWatch::CountThread(id);
+	}
+
+	this->active = (int)workers.size();
+}
+
+void WorkerPool::limit(int threads)
+{
+	this->active = (threads > 0) ? min((int)workers.size(), threads - 1) : (int)workers.size();
+}
+
+WorkerPool::~WorkerPool()
+{
+	this->quit = true;
+
+	if (!workers.empty())
+	{
+		ReleaseSemaphore(start, (LONG)workers.size(), NULL);
+		WaitForMultipleObjects((DWORD)workers.size(), &workers[0], TRUE, INFINITE);
+	}
+
+	for (std::vector<HANDLE>::iterator i = workers.begin() ; i != workers.end() ; i++)
+		CloseHandle(*i);
+
+	CloseHandle(start);
+	CloseHandle(done);
+}
+
+void WorkerPool::run(int count, ParallelBody body, void* context)
+{
+	if (count <= 0)
+		return;
+
+	// small enough runs aren't worth waking anyone for
+	if ((active == 0) || (count < 64))
+	{
+		body(0, count, context);
+		return;
+	}
+
+	this->body		= body;
+	this->context	= context;
+	this->count		= count;
+	this->chunk		= max(16, count / (this->threads() * 8));		// several chunks per thread, to even out uneven items
+	this->nextChunk	= 0;
+	this->busy		= (LONG)active;
+	this->controlWord	= _controlfp(0, 0);
+
+	ReleaseSemaphore(start, (LONG)active, NULL);
+
+	this->work();
+
+	WaitForSingleObject(done, INFINITE);
+}
+
+void WorkerPool::work()
+{
+	while (true)
+	{
+		const int begin = (InterlockedIncrement(&nextChunk) - 1) * chunk;
+		if (begin >= count)
+			return;
+
+		body(begin, min(begin + chunk, count), context);
+	}
+}
+
+unsigned __stdcall WorkerPool::Worker(void* pool)
+{
+	WorkerPool* wp = (WorkerPool*)pool;
+
+	while (true)
+	{
+		WaitForSingleObject(wp->start, INFINITE);
+
+		if (wp->quit)
+			return 0;
+
+		_controlfp(wp->controlWord, FP_CONTROLS);
+		wp->work();
+
+		if (InterlockedDecrement(&wp->busy) == 0)
+			SetEvent(wp->done);
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include <windows.h>
+#include <vector>
+
+typedef void (*ParallelBody)(int begin, int end, void* context);		// process items [begin, end)
+
+// Runs a loop body over [0, count) in chunks, shared between a pool of worker threads (one per extra processor) and the calling thread,
+// returning once every chunk is done.  The body must only write to the items it's given.
+// The workers take the calling thread's floating point precision & rounding for each run, so an item gives the same result whichever
+// thread it falls to.  (Direct3D drops its thread's x87 precision to single, leaving threads it didn't touch at double.)
+void ParallelFor(int count, ParallelBody body, void* context);
+int ParallelThreads();														// including the calling thread
+void ParallelLimit(int threads);											// use no more than this many from now on (0 for all of them)
+
+class WorkerPool
+{
+	public:
+		WorkerPool();
+		~WorkerPool();
+
+		void run(int count, ParallelBody body, void* context);
+		int threads() const							{ return active + 1; }
+		void limit(int threads);
+
+	private:
+		void work();								// claim & process chunks until there are none left
+
+		static unsigned __stdcall Worker(void* pool);
+
+		std::vector<HANDLE>	workers;
+		int					active;					// workers used for each run
+		HANDLE				start;					// semaphore, released once per worker for each run
+		HANDLE				done;					// set by the last worker to finish a run
+		volatile bool		quit;
+
+		ParallelBody		body;					// the current run
+		void*				context;
+		int					count, chunk;
+		unsigned int		controlWord;			// the calling thread's floating point control word
+		volatile LONG		nextChunk;
+		volatile LONG		busy;					// workers yet to finish the run
+};
+
+#endif
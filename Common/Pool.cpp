@@ -0,0 +1,124 @@
+#include "OpenSteer/Pool.h"
+
+#define POOL_ROUND(bytes)	((((bytes) + POOL_ALIGNMENT - 1) / POOL_ALIGNMENT) * POOL_ALIGNMENT)
+
+SlabPool::SlabPool(size_t blockSize, int blocksPerSlab)
+{
+	this->blockBytes	= POOL_ROUND(sizeof(Block)) + POOL_ROUND(blockSize);
+	this->blocksPerSlab	= blocksPerSlab;
+	this->slabBytes		= POOL_ROUND(sizeof(Slab)) + (blockBytes * blocksPerSlab);
+	this->partial		= NULL;
+	this->spare			= NULL;
+	this->slabs			= 0;
+	this->live			= 0;
+}
+
+SlabPool::~SlabPool()
+{
+	// (every block is expected back by now; a slab still wholly in use isn't listed anywhere to be found)
+	while (partial != NULL)
+	{
+		Slab* slab = partial;
+		partial = slab->next;
+		delete [] (char*)slab;
+	}
+
+	delete [] (char*)spare;
+}
+
+void* SlabPool::allocate()
+{
+	if (partial == NULL)
+	{
+		Slab* slab = spare;
+		spare = NULL;
+
+		if (slab == NULL)
+		{
+			slab = (Slab*)new char[slabBytes];
+			slab->free		= NULL;
+			slab->used		= 0;
+			slab->carved	= 0;
+			slabs++;
+		}
+
+		slab->listed = false;
+		this->list(slab);
+	}
+
+	Slab* slab = partial;
+	Block* block = slab->free;
+
+	if (block != NULL)
+		slab->free = block->next;
+	else
+	{
+		// the next block not yet handed out from this slab
+		block = (Block*)((char*)slab + POOL_ROUND(sizeof(Slab)) + (blockBytes * slab->carved));
+		block->slab = slab;
+		slab->carved++;
+	}
+
+	slab->used++;
+	live++;
+
+	if ((slab->free == NULL) && (slab->carved == blocksPerSlab))
+		this->unlist(slab);
+
+	return (char*)block + POOL_ROUND(sizeof(Block));
+}
+
+void SlabPool::release(void* p)
+{
+	if (p == NULL)
+		return;
+
+	Block* block = (Block*)((char*)p - POOL_ROUND(sizeof(Block)));
+	Slab* slab = block->slab;
+
+	block->next	= slab->free;
+	slab->free	= block;
+	slab->used--;
+	live--;
+
+	if (!slab->listed)
+		this->list(slab);
+
+	if (slab->used == 0)
+	{
+		// empty: kept as the spare, or given back if there is one already
+		this->unlist(slab);
+
+		if (spare == NULL)
+			spare = slab;
+		else
+		{
+			delete [] (char*)slab;
+			slabs--;
+		}
+	}
+}
+
+void SlabPool::list(Slab* slab)
+{
+	slab->prev		= NULL;
+	slab->next		= partial;
+	slab->listed	= true;
+
+	if (partial != NULL)
+		partial->prev = slab;
+	partial = slab;
+}
+
+void SlabPool::unlist(Slab* slab)
+{
+	if (slab->prev != NULL)
+		slab->prev->next = slab->next;
+	else
+		partial = slab->next;
+
+	if (slab->next != NULL)
+		slab->next->prev = slab->prev;
+
+	slab->listed = false;
+}
@@ -1,12 +1,14 @@
 #include "Presence.h"
 
-Presence::Presence(ProximityDatabase& pd, BoxObstacle* obstacles)
-: Boid(pd, obstacles)
+// (nothing of its own, so it keeps to the boid's budget)
+typedef char PresenceBudgetCheck[(sizeof(Presence) <= AGENT_BUDGET) ? 1 : -1];
+
+Presence::Presence(ProximityDatabase& pd, Obstacle* obstacles, int profile, const Vec3* position)
+: Boid(pd, obstacles, profile, position)
 {
-	D3DXMatrixIdentity(&this->World);
 }
 
-Presence::Presence(D3DXVECTOR3 Position, ProximityDatabase& pd, BoxObstacle* obstacles)
+Presence::Presence(D3DXVECTOR3 Position, ProximityDatabase& pd, Obstacle* obstacles)
 : Boid(pd, obstacles)
 {
 	this->SetPosition(Position);
@@ -18,44 +20,63 @@ Presence::~Presence()
 
 D3DXMATRIX Presence::GetWorld()
 {
+	return Pose(this->Position, this->_forward, this->_side);
+}
+
+D3DXMATRIX Presence::Pose(const Vec3& position, const Vec3& forward, const Vec3& side)
+{
+	D3DXMATRIX World;
+	D3DXMatrixIdentity(&World);
+
 	#ifdef TIGER
-		World._11 = -this->_side.x;
-		World._12 = -this->_side.y;
-		World._13 = -this->_side.z;
+		World._11 = -side.x;
+		World._12 = -side.y;
+		World._13 = -side.z;
 
-		World._31 = -this->_forward.x;
-		World._32 = -this->_forward.y;
-		World._33 = -this->_forward.z;
+		World._31 = -forward.x;
+		World._32 = -forward.y;
+		World._33 = -forward.z;
 
-		World._41 = Position.x;
+		World._41 = position.x;
 		World._42 = 1.0f;
-		World._43 = Position.z;
+		World._43 = position.z;
 
-		return this->World;
+		return World;
 	#else
 		D3DXMATRIX Scale;
 		D3DXMatrixScaling(&Scale, 0.005f, 0.005f, 0.005f);
 
-		World._11 = -this->_side.x;
-		World._12 = -this->_side.y;
-		World._13 = -this->_side.z;
+		World._11 = -side.x;
+		World._12 = -side.y;
+		World._13 = -side.z;
 
 		World._21 = 0.0f;
 		World._22 = 1.0f;
 		World._23 = 0.0f;
 
-		World._31 = -this->_forward.x;
-		World._32 = -this->_forward.y;
-		World._33 = -this->_forward.z;
+		World._31 = -forward.x;
+		World._32 = -forward.y;
+		World._33 = -forward.z;
 
-		World._41 = Position.x;
+		World._41 = position.x;
 		World._42 = 1.8f;
-		World._43 = Position.z;
+		World._43 = position.z;
 
-		return Scale * this->World;
+		return Scale * World;
 	#endif
 }
 
+D3DXMATRIX Presence::Pose(const Vec3& position, const Vec3& forward)
+{
+	Vec3 side;
+	if (RIGHT_HANDED)
+		side.cross(forward, Vec3(0.0f, 1.0f, 0.0f));
+	else
+		side.cross(Vec3(0.0f, 1.0f, 0.0f), forward);
+
+	return Pose(position, forward, side.normalize());
+}
+
 void Presence::SetPosition(D3DXVECTOR3 Position)
 {
 	this->Position = Vec3(Position.x, Position.y, Position.z);
@@ -9,19 +9,18 @@
 class Presence : public Boid
 {
 	public:
-		Presence(ProximityDatabase& pd, BoxObstacle* obstacles);
-		Presence(D3DXVECTOR3 Position, ProximityDatabase& pd, BoxObstacle* obstacles);
+		Presence(ProximityDatabase& pd, Obstacle* obstacles, int profile = 0, const Vec3* position = NULL);
+		Presence(D3DXVECTOR3 Position, ProximityDatabase& pd, Obstacle* obstacles);
 		~Presence();
 
-		D3DXMATRIX GetWorld();
+		D3DXMATRIX GetWorld();		// made from the boid's position & heading when asked for, rather than kept with every agent
+
+		static D3DXMATRIX Pose(const Vec3& position, const Vec3& forward, const Vec3& side);
+		static D3DXMATRIX Pose(const Vec3& position, const Vec3& forward);		// (side to the forward as a boid's is, as for a replay)
 
 		void SetPosition(D3DXVECTOR3 Position);
 		void MoveBy(D3DXVECTOR3 &Vector);
 
-	private:
-		void RefreshWorld();
-
-		D3DXMATRIX World;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include <fstream>
+#include <sstream>
+#include "OpenSteer/Profile.h"
+
+BehaviourProfile::BehaviourProfile() :
+	Name("default"),
+	Separation(1.0f, -0.707f, 12.0f),
+	Alignment(1.0f, 0.7f, 8.0f),
+	Cohesion(1.0f, -0.15f, 8.0f)
+{
+	this->MaxSpeed	= 9.0f;
+	this->MaxForce	= 27.0f;
+	this->Radius	= 0.5f;
+	this->Share		= 1.0f;
+
+	this->Category		= 0;
+	this->FlocksWith	= PROXIMITY_ALL;
+}
+
+float BehaviourProfile::maxRadius() const
+{
+	return max(Separation.Radius, max(Alignment.Radius, Cohesion.Radius));
+}
+
+ProfileTable::ProfileTable()
+{
+	profiles.push_back(BehaviourProfile());
+
+	written.dwLowDateTime	= 0;
+	written.dwHighDateTime	= 0;
+}
+
+int ProfileTable::find(const std::string& name) const
+{
+	for (int i = 0 ; i < (int)profiles.size() ; i++)
+		if (profiles[i].Name == name)
+			return i;
+
+	return -1;
+}
+
+int ProfileTable::add(const BehaviourProfile& profile)
+{
+	const int existing = this->find(profile.Name);
+
+	if (existing >= 0)
+	{
+		profiles[existing] = profile;
+		return existing;
+	}
+
+	if (profiles.size() >= MAX_PROFILES)
+		return -1;
+
+	profiles.push_back(profile);
+	return (int)profiles.size() - 1;
+}
+
+int ProfileTable::pick(float random) const
+{
+	float total = 0.0f;
+	for (std::vector<BehaviourProfile>::const_iterator i = profiles.begin() ; i != profiles.end() ; i++)
+		total += i->Share;
+
+	float chosen = random * total;
+	for (int i = 0 ; i < (int)profiles.size() ; i++)
+	{
+		if (chosen < profiles[i].Share)
+			return i;
+		chosen -= profiles[i].Share;
+	}
+
+	return 0;
+}
+
+bool ProfileTable::load(const char* filename)
+{
+	this->filename = filename;		// (kept even if it can't be read yet, so reload() picks it up once it can)
+
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesEx(filename, GetFileExInfoStandard, &attributes))
+		return false;
+
+	std::ifstream file(filename);
+	if (!file.is_open())
+		return false;
+
+	// read every line before adding any, so a file caught half written is ignored rather than half applied
+	std::vector<BehaviourProfile> loaded;
+	std::string line;
+
+	while (std::getline(file, line))
+	{
+		const size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+
+		std::istringstream fields(line);
+		BehaviourProfile profile;
+
+		if (!(fields >> profile.Name))
+			continue;		// blank
+
+		fields	>> profile.Separation.Radius >> profile.Separation.Angle >> profile.Separation.Weight
+				>> profile.Alignment.Radius >> profile.Alignment.Angle >> profile.Alignment.Weight
+				>> profile.Cohesion.Radius >> profile.Cohesion.Angle >> profile.Cohesion.Weight
+				>> profile.MaxSpeed >> profile.MaxForce >> profile.Radius >> profile.Share;
+
+		if (fields.fail())
+			return false;
+
+		if (fields >> profile.Category)
+		{
+			fields >> std::hex >> profile.FlocksWith;
+
+			if (fields.fail() || (profile.Category < 0) || (profile.Category >= PROXIMITY_CATEGORIES))
+				return false;
+		}
+
+		loaded.push_back(profile);
+	}
+
+	for (std::vector<BehaviourProfile>::const_iterator i = loaded.begin() ; i != loaded.end() ; i++)
+		this->add(*i);
+
+	// (only once it's been applied, so that reload() tries a file which failed to parse again rather than waiting for it to change)
+	this->written = attributes.ftLastWriteTime;
+
+	return true;
+}
+
+bool ProfileTable::reload()
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+	if (filename.empty() || !GetFileAttributesEx(filename.c_str(), GetFileExInfoStandard, &attributes))
+		return false;
+
+	if (CompareFileTime(&attributes.ftLastWriteTime, &written) == 0)
+		return false;
+
+	return this->load(filename.c_str());
+}
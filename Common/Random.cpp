@@ -0,0 +1,59 @@
+#include "OpenSteer/Random.h"
+
+#define PHILOX_M		0xD256D193u		// multiplier & Weyl key increment from Salmon et al, "Parallel random numbers: as easy as 1, 2, 3"
+#define PHILOX_W		0x9E3779B9u
+#define PHILOX_ROUNDS	10
+
+RandomStream::RandomStream(unsigned int seed, unsigned int stream)
+{
+	this->key		= seed;
+	this->stream	= stream;
+	this->counter	= 0;
+	this->spare		= 0;
+	this->hasSpare	= false;
+}
+
+unsigned int RandomStream::next()
+{
+	if (hasSpare)
+	{
+		this->hasSpare = false;
+		return spare;
+	}
+
+	unsigned int x0 = counter++;
+	unsigned int x1 = stream;
+	unsigned int k	= key;
+
+	for (int round = 0 ; round < PHILOX_ROUNDS ; round++)
+	{
+		const unsigned __int64 product = (unsigned __int64)PHILOX_M * x0;
+
+		x0	= ((unsigned int)(product >> 32)) ^ k ^ x1;
+		x1	= (unsigned int)product;
+		k	+= PHILOX_W;
+	}
+
+	this->spare		= x1;
+	this->hasSpare	= true;
+
+	return x0;
+}
+
+float RandomStream::unit()
+{
+	return (next() >> 8) * (1.0f / 16777216.0f);		// (24 bits, all a float holds, so it can't round up to 1)
+}
+
+OpenSteer::Vec3 RandomStream::inUnitSphere()
+{
+	Vec3 v;
+
+	do
+	{
+		v = Vec3((unit() * 2) - 1, (unit() * 2) - 1, (unit() * 2) - 1);
+	}
+	while (v.length() >= 1);
+
+	return v;
+}
@@ -53,14 +53,18 @@ void GfxDX9::Render(float TimeDelta)
 	this->ReadX360Pad(TimeDelta * 5.0f);
 	FPS->Update(TimeDelta);
 
-	HLSL->SetMatrix("mVP", &MainCam->GetMatrix());
+	// (a replay is seen through the camera it was recorded with, where it was)
+	D3DXMATRIX VP = MainCam->GetMatrix();
+	Crowd->AdvanceReplay(VP);
+
+	HLSL->SetMatrix("mVP", &VP);
 
 	// Clears the screen.  
 	Device->Clear(0, NULL, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, D3DXCOLOR(0.0f, 0.0f, 0.0f, 1.0f), 1.0f, 0);
 
 	Device->BeginScene();						// Begins drawing the scene.  
 		Club->Render();
-		Crowd->Render(MainCam->GetMatrix(), TimeDelta);
+		Crowd->Render(VP, TimeDelta);
 		FPS->Render();
     Device->EndScene();							// Ends drawing the scene.  
 
@@ -260,6 +264,54 @@ void GfxDX9::ReadX360Pad(float TimeDelta)
 		else if (this->Pressed_B)
 			this->Pressed_B = false;
 
+		// Back = Trajectory Recording
+		if (wButtons & XINPUT_GAMEPAD_BACK)
+		{
+			if (!this->Pressed_Back)
+			{
+				Crowd->SwitchRecording();
+				this->Pressed_Back = true;
+			}
+		}
+		else if (this->Pressed_Back)
+			this->Pressed_Back = false;
+
+		// Start = Trajectory Replay
+		if (wButtons & XINPUT_GAMEPAD_START)
+		{
+			if (!this->Pressed_Start)
+			{
+				Crowd->SwitchReplay();
+				this->Pressed_Start = true;
+			}
+		}
+		else if (this->Pressed_Start)
+			this->Pressed_Start = false;
+
+		// Up = Rewind Buffer
+		if (wButtons & XINPUT_GAMEPAD_DPAD_UP)
+		{
+			if (!this->Pressed_Up)
+			{
+				Crowd->SwitchRewind();
+				this->Pressed_Up = true;
+			}
+		}
+		else if (this->Pressed_Up)
+			this->Pressed_Up = false;
+
+		// Left = Step Back
+		if (wButtons & XINPUT_GAMEPAD_DPAD_LEFT)
+		{
+			if (!this->Pressed_Left)
+			{
+				Crowd->StepBack();
+				this->Pressed_Left = true;
+			}
+		}
+		else if (this->Pressed_Left)
+			this->Pressed_Left = false;
+
 		// Y = Skeletal Animation
 		/*	The following block of code is disabled due to issues with skeletal animation
 
@@ -59,7 +59,7 @@ class GfxDX9
 		Camera*				MainCam;
 
 		CONTROLLER_STATE	Pad;
-		bool				Pressed_LeftShoulder, Pressed_RightShoulder, Pressed_A, Pressed_B, Pressed_X, Pressed_Y;
+		bool				Pressed_LeftShoulder, Pressed_RightShoulder, Pressed_A, Pressed_B, Pressed_X, Pressed_Y, Pressed_Back, Pressed_Start, Pressed_Up, Pressed_Left;
 
 		float y; // DEBUG CODE;
 };
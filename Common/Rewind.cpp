@@ -0,0 +1,243 @@
+#include <cstring>
+#include "OpenSteer/Rewind.h"
+
+RewindBuffer::RewindBuffer()
+{
+	this->ring			= NULL;
+	this->capacity		= 0;
+	this->keyframeEvery	= REWIND_KEYFRAME;
+	this->overflows		= 0;
+
+	this->clear();
+}
+
+void RewindBuffer::configure(size_t bytes, int keyframeTicks)
+{
+	// (allocated whole now, so that recording a tick never goes to the heap once the scratch has grown to the crowd)
+	std::vector<char>().swap(storage);
+	std::vector<Entry>().swap(index);
+
+	this->capacity		= bytes - (bytes % REWIND_ALIGN);
+	this->keyframeEvery	= max(1, keyframeTicks);
+	this->ring			= NULL;
+	this->overflows		= 0;
+
+	if (capacity > 0)
+	{
+		storage.resize(capacity + REWIND_ALIGN);
+		index.resize(REWIND_TICKS);
+
+		const size_t misaligned = (size_t)&storage[0] % REWIND_ALIGN;
+		this->ring = &storage[0] + ((misaligned > 0) ? (REWIND_ALIGN - misaligned) : 0);
+	}
+
+	this->clear();
+}
+
+void RewindBuffer::clear()
+{
+	this->tail			= 0;
+	this->used			= 0;
+	this->first			= 0;
+	this->count			= 0;
+	this->nextTick		= 0;
+	this->sinceKeyframe	= 0;
+	this->changed		= false;
+
+	current.clear();
+	previous.clear();
+}
+
+void RewindBuffer::beginTick()
+{
+	current.clear();
+	this->changed = false;
+}
+
+void RewindBuffer::add(AgentHandle handle, const Vec3& position, const Vec3& forward)
+{
+	if ((current.size() >= previous.size()) || (previous[current.size()].Handle != handle))
+		this->changed = true;
+
+	current.push_back(QuantisedAgent());
+	TrajectoryCodec::Quantise(handle, position, forward, current.back());
+}
+
+bool RewindBuffer::keyframeDue() const
+{
+	return (count == 0) || changed || (current.size() != previous.size()) || (sinceKeyframe >= keyframeEvery);
+}
+
+void RewindBuffer::endTick(const std::vector<char>* image)
+{
+	const bool keyframe = (image != NULL);
+
+	if (!this->enabled())
+		return;
+
+	if (count == (int)index.size())
+		this->evict();
+
+	coded.clear();
+	if (keyframe)
+		TrajectoryCodec::PutKeyframe(coded, current);
+	else
+		TrajectoryCodec::PutChanges(coded, current, previous);
+
+	const size_t imageBytes	= keyframe ? image->size() : 0;
+	const size_t bytes		= imageBytes + coded.size();
+	char* at				= this->allocate(bytes);
+
+	// (a tick too big for the ring at all is lost, and with it everything held, which would no longer run on to the ticks after)
+	if (at == NULL)
+	{
+		const int tick = nextTick;
+
+		this->clear();
+		this->nextTick = tick + 1;
+		this->overflows++;
+
+		return;
+	}
+
+	// (a tick whose keyframe had to go to make room for it is no use, so the next is a keyframe instead)
+	if (keyframe || (count > 0))
+	{
+		if (keyframe)
+			memcpy(at, &(*image)[0], imageBytes);
+		if (!coded.empty())
+			memcpy(at + imageBytes, &coded[0], coded.size());
+
+		Entry& added	= entry(count);
+		added.Tick		= nextTick;
+		added.Offset	= at - ring;
+		added.Bytes		= (bytes + REWIND_ALIGN - 1) & ~(size_t)(REWIND_ALIGN - 1);
+		added.Image		= imageBytes;
+		added.Agents	= (unsigned int)current.size();
+		added.Keyframe	= keyframe;
+
+		this->tail	= added.Offset + added.Bytes;
+		this->used	+= added.Bytes;
+		this->count++;
+
+		this->sinceKeyframe = keyframe ? 1 : (sinceKeyframe + 1);
+	}
+	else
+		this->sinceKeyframe = keyframeEvery;
+
+	previous.swap(current);
+	this->nextTick++;
+}
+
+char* RewindBuffer::allocate(size_t bytes)
+{
+	bytes = (bytes + REWIND_ALIGN - 1) & ~(size_t)(REWIND_ALIGN - 1);
+	if (bytes > capacity)
+		return NULL;
+
+	while (true)
+	{
+		if (count == 0)
+		{
+			this->tail = 0;
+			return ring;
+		}
+
+		// what's held runs from the oldest tick's offset up to tail, round the end of the ring if tail's not after it (and is full if they meet)
+		const size_t head = entry(0).Offset;
+
+		if (tail > head)
+		{
+			if (capacity - tail >= bytes)
+				return ring + tail;
+			if (head >= bytes)
+				return ring;
+		}
+		else if (head - tail >= bytes)
+			return ring + tail;
+
+		this->evict();
+	}
+}
+
+void RewindBuffer::evict()
+{
+	do
+	{
+		this->used -= entry(0).Bytes;
+		this->first = (first + 1) % (int)index.size();
+		this->count--;
+	}
+	while ((count > 0) && !entry(0).Keyframe);
+}
+
+bool RewindBuffer::keyframe(int tick, const char*& image, size_t& bytes, int& keyTick) const
+{
+	if ((count == 0) || (tick < firstTick()) || (tick > lastTick()))
+		return false;
+
+	// (ticks are held one after another, so a tick's place is how far it is from the first)
+	int i = tick - firstTick();
+	while (!entry(i).Keyframe)
+		i--;
+
+	image	= ring + entry(i).Offset;
+	bytes	= entry(i).Image;
+	keyTick	= entry(i).Tick;
+
+	return true;
+}
+
+bool RewindBuffer::view(int tick, std::vector<TrajectorySample>& agents)
+{
+	if ((count == 0) || (tick < firstTick()) || (tick > lastTick()))
+		return false;
+
+	const int target = tick - firstTick();
+	int i = target;
+	while (!entry(i).Keyframe)
+		i--;
+
+	for ( ; i <= target ; i++)
+	{
+		const Entry& e				= entry(i);
+		const unsigned char* p		= (const unsigned char*)ring + e.Offset + e.Image;
+		const unsigned char* end	= (const unsigned char*)ring + e.Offset + e.Bytes;
+
+		if (e.Keyframe)
+		{
+			state.resize(e.Agents);
+			if (!TrajectoryCodec::GetKeyframe(p, end, state))
+				return false;
+		}
+		else if (!TrajectoryCodec::GetChanges(p, end, state))
+			return false;
+	}
+
+	agents.resize(state.size());
+	for (size_t a = 0 ; a < state.size() ; a++)
+		TrajectoryReader::Decode(state[a], TRAJECTORY_POSITION_STEP, agents[a]);
+
+	return true;
+}
+
+void RewindBuffer::truncate(int tick)
+{
+	while ((count > 0) && (lastTick() > tick))
+	{
+		this->count--;
+		this->used -= entry(count).Bytes;
+	}
+
+	this->tail		= (count > 0) ? (entry(count - 1).Offset + entry(count - 1).Bytes) : 0;
+	this->nextTick	= tick + 1;
+
+	// (the crowd's carried on from a restored keyframe, as new boids with new handles, so the next tick's a keyframe too)
+	previous.clear();
+}
+
+size_t RewindBuffer::reservedBytes() const
+{
+	return storage.capacity() + (index.capacity() * sizeof(Entry)) + coded.capacity() +
+		((current.capacity() + previous.capacity() + state.capacity()) * sizeof(QuantisedAgent));
+}
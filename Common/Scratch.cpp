@@ -0,0 +1,112 @@
+#include <windows.h>
+#include "OpenSteer/Scratch.h"
+
+// Every thread's arena, made the first time the thread asks for one and kept to the end of the program
+class ArenaRegistry
+{
+	public:
+		ArenaRegistry()
+		{
+			InitializeCriticalSection(&lock);
+		}
+
+		~ArenaRegistry()
+		{
+			for (std::vector<ScratchArena*>::iterator i = arenas.begin() ; i != arenas.end() ; i++)
+				delete *i;
+
+			DeleteCriticalSection(&lock);
+		}
+
+		ScratchArena* add()
+		{
+			ScratchArena* arena = new ScratchArena();
+
+			EnterCriticalSection(&lock);
+			arenas.push_back(arena);
+			LeaveCriticalSection(&lock);
+
+			return arena;
+		}
+
+		std::vector<ScratchArena*> arenas;
+
+	private:
+		CRITICAL_SECTION lock;
+};
+
+static ArenaRegistry Registry;						// (constructed before main, so before any worker can ask)
+static __declspec(thread) ScratchArena* LocalArena = NULL;
+
+ScratchArena::ScratchArena()
+{
+	this->current	= 0;
+	this->used		= 0;
+}
+
+ScratchArena::~ScratchArena()
+{
+	for (std::vector<Block>::iterator i = blocks.begin() ; i != blocks.end() ; i++)
+		delete [] i->memory;
+}
+
+void* ScratchArena::allocate(size_t bytes)
+{
+	bytes = (bytes + SCRATCH_ALIGNMENT - 1) & ~(size_t)(SCRATCH_ALIGNMENT - 1);
+
+	// on through the blocks kept from earlier frames, only going to the heap for a new one past the last of them
+	while ((current < blocks.size()) && (used + bytes > blocks[current].size))
+	{
+		this->current++;
+		this->used = 0;
+	}
+
+	if (current == blocks.size())
+	{
+		Block block;
+		block.size		= max(bytes, (size_t)SCRATCH_BLOCK);
+		block.memory	= new char[block.size];
+		blocks.push_back(block);
+	}
+
+	void* p = blocks[current].memory + used;
+	this->used += bytes;
+	return p;
+}
+
+ScratchArena& ScratchArena::Local()
+{
+	if (LocalArena == NULL)
+		LocalArena = Registry.add();
+
+	return *LocalArena;
+}
+
+void ScratchArena::NextFrame()
+{
+	for (std::vector<ScratchArena*>::iterator i = Registry.arenas.begin() ; i != Registry.arenas.end() ; i++)
+	{
+		(**i).neighbours.clear();
+		(**i).aggregates.clear();
+		(**i).contacts.clear();
+		(**i).current	= 0;
+		(**i).used		= 0;
+	}
+}
+
+size_t ScratchArena::ReservedBytes()
+{
+	size_t bytes = 0;
+
+	for (std::vector<ScratchArena*>::const_iterator i = Registry.arenas.begin() ; i != Registry.arenas.end() ; i++)
+	{
+		bytes += (**i).neighbours.capacity() * sizeof(AbstractVehicle*);
+		bytes += (**i).aggregates.capacity() * sizeof(ProximityAggregate);
+		bytes += (**i).contacts.capacity() * sizeof(AbstractVehicle*);
+
+		for (std::vector<Block>::const_iterator b = (**i).blocks.begin() ; b != (**i).blocks.end() ; b++)
+			bytes += b->size;
+	}
+
+	return bytes;
+}
@@ -0,0 +1,289 @@
+#include "OpenSteer/Script.h"
+
+#define ARENA_GRAIN		16				// scripts are sized up to a multiple of this...
+#define ARENA_CLASSES	32				// ...and pooled up to this many multiples; anything bigger goes to the heap
+#define ARENA_PAGE		65536			// bytes reserved at a time
+
+// Free lists of script-sized blocks, carved from pages which are kept for the life of the program
+class ScriptArena
+{
+	public:
+		ScriptArena()
+		{
+			for (int i = 0 ; i < ARENA_CLASSES ; i++)
+				free[i] = NULL;
+
+			this->cursor	= NULL;
+			this->remaining	= 0;
+			this->reserved	= 0;
+		}
+
+		~ScriptArena()
+		{
+			for (std::vector<char*>::iterator i = pages.begin() ; i != pages.end() ; i++)
+				delete [] *i;
+		}
+
+		void* allocate(size_t size)
+		{
+			const size_t sizeClass = (size + ARENA_GRAIN - 1) / ARENA_GRAIN;
+
+			if (sizeClass > ARENA_CLASSES)
+				return ::operator new(size);
+
+			if (free[sizeClass - 1] != NULL)
+			{
+				Block* block = free[sizeClass - 1];
+				free[sizeClass - 1] = block->next;
+				return block;
+			}
+
+			const size_t bytes = sizeClass * ARENA_GRAIN;
+
+			if (remaining < bytes)
+			{
+				this->cursor	= new char[ARENA_PAGE];
+				this->remaining	= ARENA_PAGE;
+				this->reserved	+= ARENA_PAGE;
+				pages.push_back(cursor);
+			}
+
+			void* p = cursor;
+			cursor		+= bytes;
+			remaining	-= bytes;
+			return p;
+		}
+
+		void release(void* p, size_t size)
+		{
+			const size_t sizeClass = (size + ARENA_GRAIN - 1) / ARENA_GRAIN;
+
+			if (sizeClass > ARENA_CLASSES)
+			{
+				::operator delete(p);
+				return;
+			}
+
+			Block* block = (Block*)p;
+			block->next = free[sizeClass - 1];
+			free[sizeClass - 1] = block;
+		}
+
+		size_t reserved;
+
+	private:
+		struct Block
+		{
+			Block* next;
+		};
+
+		Block* free[ARENA_CLASSES];
+		std::vector<char*> pages;
+		char* cursor;
+		size_t remaining;
+};
+
+static ScriptArena& Arena()
+{
+	static ScriptArena arena;
+	return arena;
+}
+
+Script::Script()
+{
+	this->agent		= NULL;
+	this->runner	= NULL;
+	this->line		= 0;
+	this->next		= NULL;
+	this->rounds	= 0;
+	this->goal		= -1;
+}
+
+Script::~Script()
+{
+}
+
+void* Script::operator new(size_t size)
+{
+	return Arena().allocate(size);
+}
+
+void Script::operator delete(void* p, size_t size)
+{
+	Arena().release(p, size);
+}
+
+size_t Script::ArenaBytes()
+{
+	return Arena().reserved;
+}
+
+ScriptRunner::ScriptRunner(FlowFieldCache* flowFields)
+{
+	this->flowFields	= flowFields;
+	this->tick			= 0;
+	this->clock			= 0.0f;
+	this->scripts		= 0;
+	this->resumed		= 0;
+
+	for (int i = 0 ; i < SCRIPT_SLOTS ; i++)
+		wheel[i] = NULL;
+}
+
+ScriptRunner::~ScriptRunner()
+{
+	for (int i = 0 ; i < SCRIPT_SLOTS ; i++)
+	{
+		while (wheel[i] != NULL)
+		{
+			Script* script = wheel[i];
+			wheel[i] = script->next;
+			finish(script);
+		}
+	}
+
+	for (std::vector<Script*>::iterator i = walking.begin() ; i != walking.end() ; i++)
+		finish(*i);
+
+	for (std::vector<Script*>::iterator i = woken.begin() ; i != woken.end() ; i++)
+		finish(*i);
+}
+
+void ScriptRunner::start(Script* script, Boid* agent)
+{
+	script->agent	= agent;
+	script->runner	= this;
+	agent->setScript(script);
+
+	woken.push_back(script);
+	scripts++;
+}
+
+// The script is done with at once, but is only taken out of the wheel, the walking or the batch when it next comes up there
+void ScriptRunner::cancel(Boid* agent)
+{
+	Script* script = agent->getScript();
+
+	if ((script == NULL) || (script->runner != this))
+		return;
+
+	agent->setScript(NULL);
+	script->agent	= NULL;
+	script->line	= -1;
+	scripts--;
+}
+
+// deletes a script, letting its agent (if it still has one) know
+void ScriptRunner::finish(Script* script)
+{
+	if ((script->agent != NULL) && (script->agent->getScript() == script))
+		script->agent->setScript(NULL);
+
+	delete script;
+}
+
+void ScriptRunner::wakeAfter(Script* script, float seconds)
+{
+	// due in the slot that many ticks on (at least the next), going round the wheel as many times as it takes to get there
+	const unsigned int ticks = max(1u, (unsigned int)((seconds / SCRIPT_TICK) + 0.5f));
+	const unsigned int slot = (tick + ticks) % SCRIPT_SLOTS;
+
+	script->rounds	= (ticks - 1) / SCRIPT_SLOTS;
+	script->next	= wheel[slot];
+	wheel[slot]		= script;
+}
+
+void ScriptRunner::wakeOnArrival(Script* script, int goal)
+{
+	script->goal = goal;
+	script->agent->setGoal(flowFields, goal, SCRIPT_GOAL_WEIGHT);
+
+	walking.push_back(script);
+}
+
+void ScriptRunner::update(const float elapsedTime)
+{
+	// turn the wheel, taking out of each slot passed the scripts on their last time round
+	clock += elapsedTime;
+
+	while (clock >= SCRIPT_TICK)
+	{
+		clock -= SCRIPT_TICK;
+		tick++;
+
+		Script** link = &wheel[tick % SCRIPT_SLOTS];
+
+		while (*link != NULL)
+		{
+			Script* script = *link;
+
+			if (script->rounds == 0)
+			{
+				*link = script->next;
+				woken.push_back(script);
+			}
+			else
+			{
+				script->rounds--;
+				link = &script->next;
+			}
+		}
+	}
+
+	// those walking somewhere and now there stop following its flow
+	for (size_t i = 0 ; i < walking.size() ; )
+	{
+		Script* script = walking[i];
+
+		if (script->agent == NULL)		// cancelled
+		{
+			delete script;
+
+			walking[i] = walking.back();
+			walking.pop_back();
+			continue;
+		}
+
+		const Vec3 offset = flowFields->goalPosition(script->goal) - script->agent->Position;
+
+		if (offset.lengthSquared() < (SCRIPT_ARRIVAL * SCRIPT_ARRIVAL))
+		{
+			script->agent->setGoal(NULL, -1, 0.0f);
+			script->goal = -1;
+
+			woken.push_back(script);
+
+			walking[i] = walking.back();
+			walking.pop_back();
+		}
+		else
+			i++;
+	}
+
+	// resume the batch; any which suspend again are rescheduled above, and any which finish are done with
+	std::vector<Script*> batch;
+	batch.swap(woken);
+
+	for (std::vector<Script*>::iterator i = batch.begin() ; i != batch.end() ; i++)
+	{
+		if ((**i).agent == NULL)		// cancelled, and already uncounted
+		{
+			delete *i;
+			continue;
+		}
+
+		(**i).resume();
+
+		if ((**i).line == -1)
+		{
+			finish(*i);
+			scripts--;
+		}
+	}
+
+	this->resumed = (int)batch.size();
+
+	batch.clear();
+	if (woken.empty())
+		woken.swap(batch);			// keep the capacity for next time
+}
@@ -0,0 +1,284 @@
+#include "OpenSteer/Spawn.h"
+#include "Parallel.h"
+
+void SpawnDistribution::SortByCell(std::vector<Vec3>& positions)
+{
+	if (positions.size() < 2)
+		return;
+
+	Vec3 lower = positions[0], upper = positions[0];
+	for (std::vector<Vec3>::const_iterator i = positions.begin() ; i != positions.end() ; i++)
+	{
+		lower.x = min(lower.x, i->x);
+		lower.z = min(lower.z, i->z);
+		upper.x = max(upper.x, i->x);
+		upper.z = max(upper.z, i->z);
+	}
+
+	const int div		= max(1, (int)sqrt((float)positions.size() / SPAWN_SORT_CELL));
+	const float scalex	= div / max(upper.x - lower.x, 0.001f);
+	const float scalez	= div / max(upper.z - lower.z, 0.001f);
+
+	std::vector<int> cells(positions.size());
+	std::vector<int> starts((div * div) + 1, 0);
+
+	for (size_t i = 0 ; i < positions.size() ; i++)
+	{
+		const int ix = min((int)((positions[i].x - lower.x) * scalex), div - 1);
+		const int iz = min((int)((positions[i].z - lower.z) * scalez), div - 1);
+
+		cells[i] = (ix * div) + iz;
+		starts[cells[i] + 1]++;
+	}
+
+	for (int c = 0 ; c < div * div ; c++)
+		starts[c + 1] += starts[c];
+
+	std::vector<Vec3> sorted(positions.size());
+	for (size_t i = 0 ; i < positions.size() ; i++)
+		sorted[starts[cells[i]]++] = positions[i];
+
+	positions.swap(sorted);
+}
+
+UniformSpawn::UniformSpawn(const Vec3& center, float halfLength, float halfWidth)
+{
+	this->center		= center;
+	this->halfLength	= halfLength;
+	this->halfWidth		= halfWidth;
+}
+
+void UniformSpawn::place(int count, RandomStream& random, std::vector<Vec3>& positions) const
+{
+	for (int i = 0 ; i < count ; i++)
+	{
+		const float x = ((random.unit() * 2.0f) - 1.0f) * halfLength;
+		const float z = ((random.unit() * 2.0f) - 1.0f) * halfWidth;
+		positions.push_back(center + Vec3(x, 0.0f, z));
+	}
+}
+
+// One sampling of the rectangle at one spacing
+class PoissonDiskSpawn::Sampler
+{
+	public:
+		Sampler(const PoissonDiskSpawn& spawn, float spacing, unsigned int seed)
+		: spawn(spawn)
+		{
+			this->spacing	= spacing;
+			this->cellSize	= spacing / sqrtf(2.0f);				// so that a cell can hold no more than one sample
+			this->origin	= spawn.center - Vec3(spawn.halfLength, 0.0f, spawn.halfWidth);
+			this->divx		= max(1, (int)ceil((2.0f * spawn.halfLength) / cellSize));
+			this->divz		= max(1, (int)ceil((2.0f * spawn.halfWidth) / cellSize));
+			this->seed		= seed;
+			this->round		= 0;
+			this->phase		= NULL;
+
+			filled.assign(divx * divz, 0);
+			samples.resize(divx * divz);
+
+			this->bucketOccupied();
+		}
+
+		int run(int wanted)								// returns how many samples it found
+		{
+			// cells split by (x mod 3, z mod 3): no two cells of a phase are near enough to see each other's darts
+			std::vector<int> phases[9];
+			for (int iz = 0 ; iz < divz ; iz++)
+			{
+				for (int ix = 0 ; ix < divx ; ix++)
+					phases[((iz % 3) * 3) + (ix % 3)].push_back((iz * divx) + ix);
+			}
+
+			int found = 0;
+
+			for (round = 0 ; (round < SPAWN_ROUNDS) && (found < wanted) ; round++)
+			{
+				for (int p = 0 ; p < 9 ; p++)
+				{
+					phase = &phases[p];
+					ParallelFor((int)phase->size(), PoissonDiskSpawn::ThrowDarts, this);
+				}
+
+				// cells filled this round off the lists, and stop once there are enough
+				found = (int)filled.size();
+				for (int p = 0 ; p < 9 ; p++)
+				{
+					std::vector<int>& cells = phases[p];
+					size_t empty = 0;
+
+					for (size_t i = 0 ; i < cells.size() ; i++)
+					{
+						if (!filled[cells[i]])
+							cells[empty++] = cells[i];
+					}
+
+					cells.resize(empty);
+					found -= (int)empty;
+				}
+			}
+
+			return found;
+		}
+
+		void dart(int cell)
+		{
+			RandomStream random(seed, (unsigned int)((round * filled.size()) + cell));
+
+			const int ix	= cell % divx;
+			const int iz	= cell / divx;
+			const Vec3 p	= origin + Vec3((ix + random.unit()) * cellSize, 0.0f, (iz + random.unit()) * cellSize);
+
+			if ((fabs(p.x - spawn.center.x) > spawn.halfLength) || (fabs(p.z - spawn.center.z) > spawn.halfWidth))
+				return;
+
+			if ((spawn.walls != NULL) && spawn.walls->contains(p) && (spawn.walls->distance(p) < spawn.clearance))
+				return;
+
+			const float spacingSquared = spacing * spacing;
+
+			for (int z = max(iz - 2, 0) ; z <= min(iz + 2, divz - 1) ; z++)
+			{
+				for (int x = max(ix - 2, 0) ; x <= min(ix + 2, divx - 1) ; x++)
+				{
+					const int neighbour = (z * divx) + x;
+
+					if (filled[neighbour] && ((samples[neighbour] - p).lengthSquared() < spacingSquared))
+						return;
+
+					for (int i = occupiedStart[neighbour] ; i < occupiedStart[neighbour + 1] ; i++)
+					{
+						if ((occupied[i] - p).lengthSquared() < spacingSquared)
+							return;
+					}
+				}
+			}
+
+			samples[cell]	= p;
+			filled[cell]	= 1;
+		}
+
+		void collect(std::vector<Vec3>& found) const
+		{
+			for (size_t cell = 0 ; cell < filled.size() ; cell++)
+			{
+				if (filled[cell])
+					found.push_back(samples[cell]);
+			}
+		}
+
+		std::vector<int>* phase;						// the cells of the phase being run
+
+	private:
+		// positions already taken, sorted by cell; those just outside the rectangle are counted in the nearest cell at its edge
+		void bucketOccupied()
+		{
+			occupiedStart.assign((divx * divz) + 1, 0);
+
+			if (spawn.occupied == NULL)
+				return;
+
+			std::vector<int> cells;
+			cells.reserve(spawn.occupied->size());
+
+			for (size_t i = 0 ; i < spawn.occupied->size() ; i++)
+			{
+				const Vec3 offset = ((*spawn.occupied)[i] - origin) / cellSize;
+				const int ix = (int)floor(offset.x);
+				const int iz = (int)floor(offset.z);
+
+				if ((ix < -2) || (iz < -2) || (ix >= divx + 2) || (iz >= divz + 2))
+				{
+					cells.push_back(-1);
+					continue;
+				}
+
+				const int cell = (max(0, min(iz, divz - 1)) * divx) + max(0, min(ix, divx - 1));
+				cells.push_back(cell);
+				occupiedStart[cell + 1]++;
+			}
+
+			for (size_t cell = 1 ; cell < occupiedStart.size() ; cell++)
+				occupiedStart[cell] += occupiedStart[cell - 1];
+
+			std::vector<int> next(occupiedStart.begin(), occupiedStart.end() - 1);
+			occupied.resize(occupiedStart.back());
+
+			for (size_t i = 0 ; i < cells.size() ; i++)
+			{
+				if (cells[i] >= 0)
+					occupied[next[cells[i]]++] = (*spawn.occupied)[i];
+			}
+		}
+
+		const PoissonDiskSpawn& spawn;
+		float spacing, cellSize;
+		Vec3 origin;
+		int divx, divz;
+		unsigned int seed;
+		int round;
+
+		std::vector<char> filled;						// (not bool: neighbouring cells are written from different threads)
+		std::vector<Vec3> samples;
+		std::vector<int> occupiedStart;					// per cell, where its taken positions start in occupied; one more for the end
+		std::vector<Vec3> occupied;
+};
+
+PoissonDiskSpawn::PoissonDiskSpawn(const Vec3& center, float halfLength, float halfWidth, float spacing, const DistanceField* walls, float clearance)
+{
+	this->center		= center;
+	this->halfLength	= halfLength;
+	this->halfWidth		= halfWidth;
+	this->spacing		= spacing;
+	this->walls			= walls;
+	this->clearance		= clearance;
+	this->occupied		= NULL;
+}
+
+void PoissonDiskSpawn::ThrowDarts(int begin, int end, void* sampler)
+{
+	Sampler* s = (Sampler*)sampler;
+
+	for (int i = begin ; i < end ; i++)
+		s->dart((*s->phase)[i]);
+}
+
+void PoissonDiskSpawn::place(int count, RandomStream& random, std::vector<Vec3>& positions) const
+{
+	if (count <= 0)
+		return;
+
+	// spread everyone, those already there included, evenly over the rectangle unless that brings them nearer than the spacing asked
+	const int everyone	= count + ((occupied != NULL) ? (int)occupied->size() : 0);
+	const float area	= 4.0f * halfLength * halfWidth;
+	float tryAt			= max(spacing, sqrtf((SPAWN_DENSITY * area) / everyone));
+
+	std::vector<Vec3> found;
+
+	for (int attempt = 0 ; attempt <= SPAWN_RETRIES ; attempt++)
+	{
+		found.clear();
+
+		Sampler sampler(*this, tryAt, random.next());
+		const bool enough = (sampler.run(count) >= count);
+		sampler.collect(found);
+
+		if (enough)
+			break;
+
+		tryAt *= SPAWN_SHRINK;
+	}
+
+	// a random choice of count of them (the first count of a partial shuffle)
+	const int chosen = min(count, (int)found.size());
+
+	for (int i = 0 ; i < chosen ; i++)
+	{
+		const int j = i + (int)(random.next() % (unsigned int)(found.size() - i));
+		std::swap(found[i], found[j]);
+		positions.push_back(found[i]);
+	}
+
+	if (chosen < count)
+		UniformSpawn(center, halfLength, halfWidth).place(count - chosen, random, positions);
+}
@@ -1,4 +1,5 @@
 #include "Testbed.h"
+#include "OpenSteer/WallFile.h"
 
 Testbed::Testbed(LPDIRECT3DDEVICE9 Device, LPD3DXEFFECT HLSL)
 {
@@ -59,10 +60,52 @@ void Testbed::Initialise()
 	Device->CreateVertexDeclaration(VertexElements, &VD);
 
 	this->LoadXFile("Testbed.x", VertexElements);
+	this->ExportWalls(VENUE_WALLS, VENUE_WALL_HEIGHT);
 
 	D3DXMatrixIdentity(&World);
 }
 
+//	Slices the mesh at the given height into walls on the XZ plane, and stores them in the given file for the crowd to avoid.  The slicing only 
+//	happens when the file is missing or was sliced at another height.  The mesh is drawn with an identity world matrix, so its model space 
+//	is the crowd's world space.  
+void Testbed::ExportWalls(const char* filename, float height)
+{
+	std::vector<WallSegment> Walls;
+
+	if (LoadWallFile(filename, height, Walls))
+		return;
+
+	const DWORD Stride		= Mesh->GetNumBytesPerVertex();
+	const bool WideIndices	= (Mesh->GetOptions() & D3DXMESH_32BIT) != 0;
+
+	BYTE* Vertices	= NULL;
+	void* Indices	= NULL;
+
+	Mesh->LockVertexBuffer(D3DLOCK_READONLY, (void**)&Vertices);
+	Mesh->LockIndexBuffer(D3DLOCK_READONLY, &Indices);
+
+	for (DWORD i = 0 ; i < Mesh->GetNumFaces() ; i++)
+	{
+		Vec3 Corner[3];
+
+		for (DWORD j = 0 ; j < 3 ; j++)
+		{
+			const DWORD Index		= WideIndices ? ((DWORD*)Indices)[(i * 3) + j] : ((WORD*)Indices)[(i * 3) + j];
+			const float* Position	= (const float*)(Vertices + (Index * Stride));		// position is the first element of each vertex
+
+			Corner[j] = Vec3(Position[0], Position[1], Position[2]);
+		}
+
+		SliceTriangleAtHeight(Corner[0], Corner[1], Corner[2], height, Walls);
+	}
+
+	Mesh->UnlockIndexBuffer();
+	Mesh->UnlockVertexBuffer();
+
+	SimplifyWalls(Walls, 0.05f);
+	SaveWallFile(filename, height, Walls);
+}
+
 void Testbed::Render()
 {
 	UINT uPasses;
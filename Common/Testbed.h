@@ -14,6 +14,7 @@ class Testbed
 	private:
 		void Initialise();
 		void LoadXFile(char* filename, const D3DVERTEXELEMENT9* VertexElements);
+		void ExportWalls(const char* filename, float height);		// slices the mesh into walls for the crowd, unless already done
 
 		LPDIRECT3DDEVICE9				Device;
 		LPD3DXEFFECT					HLSL;		// Handle to a loaded HLSL shader.  
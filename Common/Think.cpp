@@ -0,0 +1,52 @@
+#include "OpenSteer/Think.h"
+
+ThinkScheduler::ThinkScheduler()
+{
+	this->frame		= 0;
+	this->nextSlot	= 0;
+	this->cycle		= 1;
+}
+
+int ThinkScheduler::addBehaviour(const char* name, int period)
+{
+	names.push_back(name);
+	periods.push_back((period > 1) ? period : 1);
+
+	// the slots go round every period at once, so that wherever the count of agents stops each period is filled as evenly as it can be
+	unsigned int a = cycle, b = periods.back();
+	while (b != 0)
+	{
+		const unsigned int r = a % b;
+		a = b;
+		b = r;
+	}
+	this->cycle = (int)((cycle / a) * periods.back());
+
+	return (int)periods.size() - 1;
+}
+
+// handed out in turn, so that however many agents there are they're spread evenly over every behaviour's period
+int ThinkScheduler::assignSlot()
+{
+	const int slot = nextSlot;
+	nextSlot = (nextSlot + 1) % cycle;
+
+	return slot;
+}
+
+void ThinkScheduler::tick()
+{
+	frame++;
+}
+
+void ThinkScheduler::restart()
+{
+	this->frame		= 0;
+	this->nextSlot	= 0;
+}
+
+void ThinkScheduler::resume(unsigned int frame, int nextSlot)
+{
+	this->frame		= frame;
+	this->nextSlot	= nextSlot % cycle;
+}
@@ -0,0 +1,709 @@
+#include <cmath>
+#include <cstring>
+#include <process.h>
+#include "OpenSteer/Trajectory.h"
+
+#define TRAJECTORY_TURN		6.2831853f		// radians
+
+// Unsigned values 7 bits to a byte, low bits first, the top bit set on every byte but the last
+static inline void PutVarint(std::vector<unsigned char>& bytes, unsigned int value)
+{
+	while (value >= 0x80)
+	{
+		bytes.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((unsigned char)value);
+}
+
+// Signed values zigzagged first (0, -1, 1, -2, 2... to 0, 1, 2, 3, 4...), so that small changes either way take a byte
+static inline void PutSigned(std::vector<unsigned char>& bytes, int value)
+{
+	PutVarint(bytes, ((unsigned int)value << 1) ^ (unsigned int)(value >> 31));
+}
+
+static inline bool GetVarint(const unsigned char*& p, const unsigned char* end, unsigned int& value)
+{
+	value = 0;
+
+	for (int shift = 0 ; shift < 35 ; shift += 7)
+	{
+		if (p == end)
+			return false;
+
+		const unsigned char byte = *p++;
+		value |= (unsigned int)(byte & 0x7F) << shift;
+
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static inline bool GetSigned(const unsigned char*& p, const unsigned char* end, int& value)
+{
+	unsigned int zigzag;
+	if (!GetVarint(p, end, zigzag))
+		return false;
+
+	value = (int)(zigzag >> 1) ^ -(int)(zigzag & 1);
+	return true;
+}
+
+void TrajectoryCodec::Quantise(AgentHandle handle, const Vec3& position, const Vec3& forward, QuantisedAgent& agent)
+{
+	agent.Handle	= handle;
+	agent.X			= (int)floor((position.x / TRAJECTORY_POSITION_STEP) + 0.5f);
+	agent.Y			= (int)floor((position.y / TRAJECTORY_POSITION_STEP) + 0.5f);
+	agent.Z			= (int)floor((position.z / TRAJECTORY_POSITION_STEP) + 0.5f);
+	agent.Heading	= (int)floor((atan2(forward.x, forward.z) * (TRAJECTORY_HEADING_STEPS / TRAJECTORY_TURN)) + 0.5f) & (TRAJECTORY_HEADING_STEPS - 1);
+}
+
+void TrajectoryCodec::PutKeyframe(std::vector<unsigned char>& bytes, const std::vector<QuantisedAgent>& agents)
+{
+	for (std::vector<QuantisedAgent>::const_iterator a = agents.begin() ; a != agents.end() ; a++)
+	{
+		PutVarint(bytes, a->Handle);
+		PutSigned(bytes, a->X);
+		PutSigned(bytes, a->Y);
+		PutSigned(bytes, a->Z);
+		PutVarint(bytes, a->Heading);
+	}
+}
+
+void TrajectoryCodec::PutChanges(std::vector<unsigned char>& bytes, const std::vector<QuantisedAgent>& agents, const std::vector<QuantisedAgent>& previous)
+{
+	for (size_t i = 0 ; i < agents.size() ; i++)
+	{
+		const QuantisedAgent& a = agents[i];
+		const QuantisedAgent& p = previous[i];
+
+		// (the heading the shorter way round)
+		int turn = (a.Heading - p.Heading) & (TRAJECTORY_HEADING_STEPS - 1);
+		if (turn >= TRAJECTORY_HEADING_STEPS / 2)
+			turn -= TRAJECTORY_HEADING_STEPS;
+
+		PutSigned(bytes, a.X - p.X);
+		PutSigned(bytes, a.Y - p.Y);
+		PutSigned(bytes, a.Z - p.Z);
+		PutSigned(bytes, turn);
+	}
+}
+
+bool TrajectoryCodec::GetKeyframe(const unsigned char*& p, const unsigned char* end, std::vector<QuantisedAgent>& agents)
+{
+	for (std::vector<QuantisedAgent>::iterator a = agents.begin() ; a != agents.end() ; a++)
+	{
+		unsigned int handle, heading;
+
+		if (!GetVarint(p, end, handle) || !GetSigned(p, end, a->X) || !GetSigned(p, end, a->Y) || !GetSigned(p, end, a->Z) ||
+			!GetVarint(p, end, heading))
+			return false;
+
+		a->Handle	= handle;
+		a->Heading	= heading;
+	}
+
+	return true;
+}
+
+bool TrajectoryCodec::GetChanges(const unsigned char*& p, const unsigned char* end, std::vector<QuantisedAgent>& agents)
+{
+	for (std::vector<QuantisedAgent>::iterator a = agents.begin() ; a != agents.end() ; a++)
+	{
+		int dx, dy, dz, turn;
+
+		if (!GetSigned(p, end, dx) || !GetSigned(p, end, dy) || !GetSigned(p, end, dz) || !GetSigned(p, end, turn))
+			return false;
+
+		a->X		+= dx;
+		a->Y		+= dy;
+		a->Z		+= dz;
+		a->Heading	= (a->Heading + turn) & (TRAJECTORY_HEADING_STEPS - 1);
+	}
+
+	return true;
+}
+
+TrajectoryRecorder::TrajectoryRecorder()
+{
+	this->thread		= NULL;
+	this->wake			= NULL;
+	this->quit			= false;
+	this->failed		= false;
+	this->chunk			= NULL;
+	this->changed		= false;
+	this->viewed		= false;
+	this->frameCount	= 0;
+	this->encoding		= 0.0;
+	this->encoded		= 0;
+	this->offset		= 0;
+
+	InitializeCriticalSection(&lock);
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+	this->close();
+
+	for (std::vector<Chunk*>::iterator i = spare.begin() ; i != spare.end() ; i++)
+		delete *i;
+
+	DeleteCriticalSection(&lock);
+}
+
+bool TrajectoryRecorder::open(const char* filename)
+{
+	this->close();
+
+	file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		file.clear();
+		return false;
+	}
+
+	const TRAJECTORY_HEADER header = { {'O', 'V', 'C', 'T'}, TRAJECTORY_VERSION, TRAJECTORY_POSITION_STEP, TRAJECTORY_KEYFRAME };
+	file.write((const char*)&header, sizeof(header));
+	if (!file)
+	{
+		file.close();
+		file.clear();
+		return false;
+	}
+
+	this->offset		= sizeof(header);
+	this->frameCount	= 0;
+	this->encoding		= 0.0;
+	this->encoded		= 0;
+	this->quit			= false;
+	this->failed		= false;
+	this->viewed		= false;
+
+	current.clear();
+	previous.clear();
+	index.clear();
+	index.reserve(TRAJECTORY_INDEX_RESERVE);
+
+	this->wake		= CreateEvent(NULL, FALSE, FALSE, NULL);
+	this->thread	= (wake != NULL) ? (HANDLE)_beginthreadex(NULL, 0, Writer, this, 0, NULL) : NULL;
+
+	// (without a writer there's no recording, so no file left behind looking like one that was cut short)
+	if (thread == NULL)
+	{
+		if (wake != NULL)
+			CloseHandle(wake);
+		this->wake = NULL;
+
+		file.close();
+		file.clear();
+		return false;
+	}
+
+	return true;
+}
+
+void TrajectoryRecorder::close()
+{
+	if (thread == NULL)
+		return;
+
+	// the last chunk, however short, then everything written before the index goes after it
+	if (chunk != NULL)
+		this->submit();
+
+	EnterCriticalSection(&lock);
+	this->quit = true;
+	LeaveCriticalSection(&lock);
+
+	SetEvent(wake);
+	WaitForSingleObject(thread, INFINITE);
+
+	CloseHandle(thread);
+	CloseHandle(wake);
+	this->thread	= NULL;
+	this->wake		= NULL;
+
+	// (no footer after a failed write, so that a reader takes the recording as not closed properly rather than short of frames)
+	if (!failed)
+	{
+		const TRAJECTORY_FOOTER footer = { offset, (unsigned int)index.size(), (unsigned int)frameCount, {'O', 'V', 'C', 'I'}, 0 };
+		if (!index.empty())
+			file.write((const char*)&index[0], (std::streamsize)(index.size() * sizeof(TRAJECTORY_INDEX)));
+		file.write((const char*)&footer, sizeof(footer));
+	}
+
+	file.close();
+	file.clear();
+}
+
+void TrajectoryRecorder::camera(const float viewProjection[TRAJECTORY_CAMERA])
+{
+	memcpy(this->viewProjection, viewProjection, sizeof(this->viewProjection));
+	this->viewed = true;
+}
+
+void TrajectoryRecorder::beginFrame()
+{
+	frameTimer.Start();
+
+	current.clear();
+	this->changed = false;
+}
+
+void TrajectoryRecorder::add(AgentHandle handle, const Vec3& position, const Vec3& forward)
+{
+	if ((current.size() >= previous.size()) || (previous[current.size()].Handle != handle))
+		this->changed = true;
+
+	current.push_back(QuantisedAgent());
+	TrajectoryCodec::Quantise(handle, position, forward, current.back());
+}
+
+void TrajectoryRecorder::endFrame()
+{
+	if (current.size() != previous.size())
+		this->changed = true;
+
+	// a new chunk, starting with a keyframe, when this one's full or the agents aren't the ones its frames are changes to
+	if ((chunk != NULL) && (changed || (chunk->header.Frames >= TRAJECTORY_KEYFRAME)))
+		this->submit();
+
+	const size_t before = (chunk != NULL) ? chunk->bytes.size() : 0;
+
+	if (chunk == NULL)
+	{
+		EnterCriticalSection(&lock);
+		if (!spare.empty())
+		{
+			this->chunk = spare.back();
+			spare.pop_back();
+		}
+		LeaveCriticalSection(&lock);
+
+		if (chunk == NULL)
+			this->chunk = new Chunk;
+
+		chunk->header.FirstFrame	= frameCount;
+		chunk->header.Frames		= 0;
+		chunk->header.Agents		= (unsigned int)current.size();
+		chunk->header.Bytes			= 0;
+		chunk->bytes.clear();
+	}
+
+	chunk->bytes.push_back(viewed ? 1 : 0);
+	if (viewed)
+		chunk->bytes.insert(chunk->bytes.end(), (const unsigned char*)viewProjection, (const unsigned char*)(viewProjection + TRAJECTORY_CAMERA));
+
+	if (chunk->header.Frames == 0)
+		TrajectoryCodec::PutKeyframe(chunk->bytes, current);
+	else
+		TrajectoryCodec::PutChanges(chunk->bytes, current, previous);
+
+	chunk->header.Frames++;
+	this->frameCount++;
+	this->encoded += chunk->bytes.size() - before;
+
+	previous.swap(current);
+
+	this->encoding += frameTimer.Stop();
+}
+
+void TrajectoryRecorder::submit()
+{
+	chunk->header.Bytes = (unsigned int)chunk->bytes.size();
+
+	EnterCriticalSection(&lock);
+	pending.push_back(chunk);
+	LeaveCriticalSection(&lock);
+
+	SetEvent(wake);
+	this->chunk = NULL;
+}
+
+void TrajectoryRecorder::write(Chunk* chunk)
+{
+	TRAJECTORY_INDEX entry;
+	entry.Offset		= offset;
+	entry.FirstFrame	= chunk->header.FirstFrame;
+	entry.Agents		= chunk->header.Agents;
+	index.push_back(entry);
+
+	file.write((const char*)&chunk->header, sizeof(TRAJECTORY_CHUNK));
+	if (!chunk->bytes.empty())
+		file.write((const char*)&chunk->bytes[0], (std::streamsize)chunk->bytes.size());
+
+	this->offset += sizeof(TRAJECTORY_CHUNK) + chunk->bytes.size();
+
+	if (!file)
+		this->failed = true;
+}
+
+unsigned __stdcall TrajectoryRecorder::Writer(void* recorder)
+{
+	TrajectoryRecorder* tr = (TrajectoryRecorder*)recorder;
+	std::vector<Chunk*> batch;
+
+	while (true)
+	{
+		WaitForSingleObject(tr->wake, INFINITE);
+
+		while (true)
+		{
+			EnterCriticalSection(&tr->lock);
+			batch.swap(tr->pending);
+			const bool quit = tr->quit;
+			LeaveCriticalSection(&tr->lock);
+
+			// (quitting only once everything submitted before has been written)
+			if (batch.empty())
+			{
+				if (quit)
+					return 0;
+				break;
+			}
+
+			// (once a write's failed the rest are only recycled: the file's of no use past it)
+			for (std::vector<Chunk*>::const_iterator i = batch.begin() ; (i != batch.end()) && !tr->failed ; i++)
+				tr->write(*i);
+
+			EnterCriticalSection(&tr->lock);
+			tr->spare.insert(tr->spare.end(), batch.begin(), batch.end());
+			LeaveCriticalSection(&tr->lock);
+
+			batch.clear();
+		}
+	}
+}
+
+TrajectoryReader::TrajectoryReader()
+{
+	this->file			= INVALID_HANDLE_VALUE;
+	this->mapping		= NULL;
+	this->view			= NULL;
+	this->size			= 0;
+	this->frameCount	= 0;
+	this->chunk			= -1;
+	this->cursor		= NULL;
+	this->chunkEnd		= NULL;
+	this->decoded		= -1;
+	this->viewed		= false;
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+	this->close();
+}
+
+bool TrajectoryReader::open(const char* filename)
+{
+	this->close();
+
+	this->file = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER bytes;
+	if (!GetFileSizeEx(file, &bytes) || (bytes.QuadPart < (LONGLONG)(sizeof(TRAJECTORY_HEADER) + sizeof(TRAJECTORY_FOOTER))))
+	{
+		this->close();
+		return false;
+	}
+
+	this->mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL)
+		this->view = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (view == NULL)
+	{
+		this->close();
+		return false;
+	}
+
+	this->size = bytes.QuadPart;
+
+	// (copied out, as nothing after the header is aligned)
+	TRAJECTORY_FOOTER footer;
+	memcpy(&header, view, sizeof(header));
+	memcpy(&footer, view + size - sizeof(footer), sizeof(footer));
+
+	if ((memcmp(header.Magic, "OVCT", 4) != 0) || (header.Version != TRAJECTORY_VERSION) || (memcmp(footer.Magic, "OVCI", 4) != 0) ||
+		(footer.IndexOffset + footer.Chunks * sizeof(TRAJECTORY_INDEX) + sizeof(footer) != size))
+	{
+		this->close();
+		return false;
+	}
+
+	index.resize(footer.Chunks);
+	if (!index.empty())
+		memcpy(&index[0], view + footer.IndexOffset, index.size() * sizeof(TRAJECTORY_INDEX));
+
+	this->frameCount = footer.Frames;
+	return true;
+}
+
+void TrajectoryReader::close()
+{
+	if (view != NULL)
+		UnmapViewOfFile(view);
+	if (mapping != NULL)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+
+	this->file		= INVALID_HANDLE_VALUE;
+	this->mapping	= NULL;
+	this->view		= NULL;
+	this->size		= 0;
+
+	index.clear();
+	this->frameCount	= 0;
+	this->chunk			= -1;
+	this->decoded		= -1;
+	this->viewed		= false;
+}
+
+bool TrajectoryReader::load(int chunk)
+{
+	this->chunk = -1;
+
+	const unsigned __int64 offset = index[chunk].Offset;
+	if (offset + sizeof(chunkHeader) > size)
+		return false;
+
+	memcpy(&chunkHeader, view + offset, sizeof(chunkHeader));
+	if (offset + sizeof(chunkHeader) + chunkHeader.Bytes > size)
+		return false;
+
+	state.resize(chunkHeader.Agents);
+
+	this->chunk		= chunk;
+	this->cursor	= view + offset + sizeof(chunkHeader);
+	this->chunkEnd	= cursor + chunkHeader.Bytes;
+	this->decoded	= -1;
+
+	return true;
+}
+
+bool TrajectoryReader::read(int frame, std::vector<TrajectorySample>& agents)
+{
+	if ((frame < 0) || (frame >= frameCount))
+		return false;
+
+	// the chunk holding the frame, the last to start at or before it, unless it's the one loaded
+	if ((chunk < 0) || (frame < (int)chunkHeader.FirstFrame) || (frame >= (int)(chunkHeader.FirstFrame + chunkHeader.Frames)))
+	{
+		int first = 0, last = (int)index.size() - 1;
+		while (first < last)
+		{
+			const int middle = (first + last + 1) / 2;
+			if ((int)index[middle].FirstFrame <= frame)
+				first = middle;
+			else
+				last = middle - 1;
+		}
+
+		if (!this->load(first))
+			return false;
+	}
+
+	// from the keyframe again if the frame's behind those decoded
+	if ((frame < decoded) && !this->load(chunk))
+		return false;
+
+	const unsigned char* p = cursor;
+
+	while (decoded < frame)
+	{
+		if (p == chunkEnd)
+			return false;
+
+		this->viewed = (*p++ != 0);
+		if (viewed)
+		{
+			if (chunkEnd - p < (int)sizeof(viewProjection))
+				return false;
+
+			memcpy(viewProjection, p, sizeof(viewProjection));
+			p += sizeof(viewProjection);
+		}
+
+		if ((decoded < 0) && !TrajectoryCodec::GetKeyframe(p, chunkEnd, state))
+			return false;
+		if ((decoded >= 0) && !TrajectoryCodec::GetChanges(p, chunkEnd, state))
+			return false;
+
+		this->decoded	= (decoded < 0) ? (int)chunkHeader.FirstFrame : (decoded + 1);
+		this->cursor	= p;
+	}
+
+	agents.resize(state.size());
+	for (size_t i = 0 ; i < state.size() ; i++)
+		Decode(state[i], header.PositionStep, agents[i]);
+
+	return true;
+}
+
+void TrajectoryReader::Decode(const QuantisedAgent& quantised, float positionStep, TrajectorySample& sample)
+{
+	const float heading = quantised.Heading * (TRAJECTORY_TURN / TRAJECTORY_HEADING_STEPS);
+
+	sample.Handle	= quantised.Handle;
+	sample.Position	= Vec3(quantised.X * positionStep, quantised.Y * positionStep, quantised.Z * positionStep);
+	sample.Forward	= Vec3(sin(heading), 0.0f, cos(heading));
+}
+
+TrajectoryReplay::TrajectoryReplay()
+{
+	this->thread		= NULL;
+	this->wake			= NULL;
+	this->ready			= NULL;
+	this->decodedCount	= 0;
+	this->takenCount	= 0;
+	this->finished		= false;
+	this->quit			= false;
+	this->holding		= false;
+	this->waiting		= 0.0;
+
+	InitializeCriticalSection(&lock);
+}
+
+TrajectoryReplay::~TrajectoryReplay()
+{
+	this->close();
+
+	DeleteCriticalSection(&lock);
+}
+
+bool TrajectoryReplay::open(const char* filename)
+{
+	this->close();
+
+	if (!reader.open(filename))
+		return false;
+
+	this->decodedCount	= 0;
+	this->takenCount	= 0;
+	this->finished		= false;
+	this->quit			= false;
+	this->holding		= false;
+	this->waiting		= 0.0;
+
+	this->wake		= CreateEvent(NULL, FALSE, FALSE, NULL);
+	this->ready		= CreateEvent(NULL, FALSE, FALSE, NULL);
+	this->thread	= (HANDLE)_beginthreadex(NULL, 0, Decoder, this, 0, NULL);
+
+	return true;
+}
+
+void TrajectoryReplay::close()
+{
+	if (thread == NULL)
+		return;
+
+	EnterCriticalSection(&lock);
+	this->quit = true;
+	LeaveCriticalSection(&lock);
+
+	SetEvent(wake);
+	WaitForSingleObject(thread, INFINITE);
+
+	CloseHandle(thread);
+	CloseHandle(wake);
+	CloseHandle(ready);
+	this->thread	= NULL;
+	this->wake		= NULL;
+	this->ready		= NULL;
+
+	reader.close();
+}
+
+const ReplayFrame* TrajectoryReplay::next()
+{
+	if (thread == NULL)
+		return NULL;
+
+	// the last frame's slot, back to the decoder
+	if (holding)
+	{
+		EnterCriticalSection(&lock);
+		this->takenCount++;
+		LeaveCriticalSection(&lock);
+
+		SetEvent(wake);
+		this->holding = false;
+	}
+
+	waitTimer.Start();
+
+	bool decoded, done;
+	while (true)
+	{
+		EnterCriticalSection(&lock);
+		decoded	= (decodedCount > takenCount);
+		done	= finished;
+		LeaveCriticalSection(&lock);
+
+		if (decoded || done)
+			break;
+
+		WaitForSingleObject(ready, INFINITE);
+	}
+
+	this->waiting += waitTimer.Stop();
+
+	if (!decoded)
+		return NULL;
+
+	this->holding = true;
+	return &ahead[takenCount % REPLAY_AHEAD];
+}
+
+unsigned __stdcall TrajectoryReplay::Decoder(void* replay)
+{
+	TrajectoryReplay* tr = (TrajectoryReplay*)replay;
+
+	for (int frame = 0 ; frame < tr->reader.frames() ; frame++)
+	{
+		// (waiting for a slot to decode into)
+		while (true)
+		{
+			EnterCriticalSection(&tr->lock);
+			const bool quit = tr->quit;
+			const bool free = (frame - tr->takenCount < REPLAY_AHEAD);
+			LeaveCriticalSection(&tr->lock);
+
+			if (quit)
+				return 0;
+			if (free)
+				break;
+
+			WaitForSingleObject(tr->wake, INFINITE);
+		}
+
+		ReplayFrame& decoding = tr->ahead[frame % REPLAY_AHEAD];
+		if (!tr->reader.read(frame, decoding.Agents))
+			break;
+
+		const float* camera = tr->reader.camera();
+		decoding.Frame	= frame;
+		decoding.Camera	= (camera != NULL);
+		if (camera != NULL)
+			memcpy(decoding.ViewProjection, camera, sizeof(decoding.ViewProjection));
+
+		EnterCriticalSection(&tr->lock);
+		tr->decodedCount = frame + 1;
+		LeaveCriticalSection(&tr->lock);
+
+		SetEvent(tr->ready);
+	}
+
+	// (the end, or a frame that couldn't be read: either way there are no more)
+	EnterCriticalSection(&tr->lock);
+	tr->finished = true;
+	LeaveCriticalSection(&tr->lock);
+
+	SetEvent(tr->ready);
+	return 0;
+}
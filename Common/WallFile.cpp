@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "OpenSteer/WallFile.h"
+
+#define WALL_FILE_VERSION	1
+
+struct WALL_FILE_HEADER
+{
+	char			Magic[4];		// "OVCW"
+	unsigned int	Version;
+	float			Height;			// height the walls were sliced at
+	unsigned int	Count;			// number of walls following the header
+};
+
+void SliceTriangleAtHeight(const Vec3& a, const Vec3& b, const Vec3& c, float height, std::vector<WallSegment>& walls)
+{
+	const Vec3 corners[3] = {a, b, c};
+	Vec3 crossings[2];
+	int found = 0;
+
+	// An edge crosses the plane when its ends lie on opposite sides.  A corner exactly on the plane is counted as above it, so a triangle is 
+	// crossed by either none or two of its edges, and one lying flat in the plane by none.  
+	for (int i = 0 ; i < 3 ; i++)
+	{
+		const Vec3& p	= corners[i];
+		const Vec3& q	= corners[(i + 1) % 3];
+		const float dp	= p.y - height;
+		const float dq	= q.y - height;
+
+		if ((dp < 0.0f) != (dq < 0.0f))
+			crossings[found++] = (p + ((q - p) * (dp / (dp - dq)))).setYtoZero();
+	}
+
+	if ((found == 2) && ((crossings[1] - crossings[0]).lengthSquared() > 0.0f))
+		walls.push_back(WallSegment(crossings[0], crossings[1]));
+}
+
+// If b lies along a (both of its ends within tolerance of a's line) and the two touch or overlap, extend a to cover both and return true.  
+static bool MergeCollinear(WallSegment& a, const WallSegment& b, float tolerance)
+{
+	const Vec3 line			= a.End - a.Start;
+	const float length		= line.length();
+	const Vec3 direction	= line / length;
+
+	const Vec3 bs = b.Start - a.Start;
+	const Vec3 be = b.End - a.Start;
+
+	if ((bs.perpendicularComponent(direction).length() > tolerance) || (be.perpendicularComponent(direction).length() > tolerance))
+		return false;
+
+	const float s0 = std::min(bs.dot(direction), be.dot(direction));
+	const float s1 = std::max(bs.dot(direction), be.dot(direction));
+
+	if ((s0 > length + tolerance) || (s1 < -tolerance))
+		return false;
+
+	const Vec3 origin = a.Start;
+	a.Start	= origin + (direction * std::min(0.0f, s0));
+	a.End	= origin + (direction * std::max(length, s1));
+
+	return true;
+}
+
+void SimplifyWalls(std::vector<WallSegment>& walls, float tolerance)
+{
+	// drop slivers from triangles which barely reach the plane
+	for (size_t i = 0 ; i < walls.size() ; )
+	{
+		if ((walls[i].End - walls[i].Start).length() < tolerance)
+			walls.erase(walls.begin() + i);
+		else
+			i++;
+	}
+
+	// merge until nothing more merges (a merge can bring a wall into line with one already passed over)
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+
+		for (size_t i = 0 ; i < walls.size() ; i++)
+		{
+			for (size_t j = i + 1 ; j < walls.size() ; )
+			{
+				if (MergeCollinear(walls[i], walls[j], tolerance))
+				{
+					walls.erase(walls.begin() + j);
+					merged = true;
+				}
+				else
+					j++;
+			}
+		}
+	}
+}
+
+bool SaveWallFile(const char* filename, float height, const std::vector<WallSegment>& walls)
+{
+	std::ofstream file(filename, std::ios::out | std::ios::binary);
+	if (!file)
+		return false;
+
+	WALL_FILE_HEADER Header = { {'O', 'V', 'C', 'W'}, WALL_FILE_VERSION, height, (unsigned int)walls.size() };
+	file.write((const char*)&Header, sizeof(WALL_FILE_HEADER));
+
+	for (std::vector<WallSegment>::const_iterator w = walls.begin() ; w != walls.end() ; w++)
+	{
+		const float Ends[4] = {w->Start.x, w->Start.z, w->End.x, w->End.z};
+		file.write((const char*)Ends, sizeof(Ends));
+	}
+
+	return file.good();
+}
+
+bool LoadWallFile(const char* filename, float height, std::vector<WallSegment>& walls)
+{
+	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	if (!file)
+		return false;
+
+	WALL_FILE_HEADER Header;
+	file.read((char*)&Header, sizeof(WALL_FILE_HEADER));
+
+	if (!file || (memcmp(Header.Magic, "OVCW", 4) != 0) || (Header.Version != WALL_FILE_VERSION) || (Header.Height != height))
+		return false;
+
+	std::vector<float> Ends(Header.Count * 4);
+	if (Header.Count > 0)
+		file.read((char*)&Ends[0], Ends.size() * sizeof(float));
+
+	if (!file)
+		return false;
+
+	for (unsigned int i = 0 ; i < Header.Count ; i++)
+		walls.push_back(WallSegment(Vec3(Ends[i * 4], 0.0f, Ends[(i * 4) + 1]), Vec3(Ends[(i * 4) + 2], 0.0f, Ends[(i * 4) + 3])));
+
+	return true;
+}
@@ -62,6 +62,7 @@
 /*                                                                    */
 /* ------------------------------------------------------------------ */
 
+#include <string.h>
 #include "OpenSteer/lq.h"
 
 #define lqBinCoordsToBinIndex(lq, ix, iy, iz)	((ix * (lq)->divy * (lq)->divz) + (iy * (lq)->divz) + iz)		/* Determine index into linear bin array given 3D bin indices */
@@ -73,8 +74,10 @@ typedef struct lqInternalDB
     float originx, originy, originz;				// the origin is the super-brick corner minimum coordinates
     float sizex, sizey, sizez;						// length of the edges of the super-brick
     int divx, divy, divz;							// number of sub-brick divisions in each direction
-    lqClientProxy** bins;							// pointer to an array of pointers, one for each bin
-    lqClientProxy* other;							// extra bin for "everything else" (points outside super-brick)
+    lqClientProxy** bins;							// pointer to an array of pointers, LQ_CATEGORIES for each bin (one per category)
+    lqClientProxy* other[LQ_CATEGORIES];			// extra bin for "everything else" (points outside super-brick), likewise by category
+    lqBinAggregate* aggregates;						// running totals for each bin & category, parallel to the bin array
+    lqBinAggregate otherAggregates[LQ_CATEGORIES];	// running totals for the "other" bin
 } lqInternalDB;
 
 //	Allocate and initialize an LQ database, returns a pointer to it. The application needs to call this before using the LQ facility.
@@ -99,6 +102,7 @@ lqInternalDB* lqCreateDatabase(float originx,	float originy,	float originz,
 void lqDeleteDatabase(lqDB* lq)
 {
     free(lq->bins);
+    free(lq->aggregates);
     free(lq);
 }
 
@@ -121,28 +125,30 @@ void lqInitDatabase(lqInternalDB* lq,	float originx, float originy, float origin
 
     {
 		int i;
-		int bincount	= divx * divy * divz;
+		int bincount	= divx * divy * divz * LQ_CATEGORIES;
 		int arraysize	= sizeof(lqClientProxy*) * bincount;
 		lq->bins		= (lqClientProxy**)malloc(arraysize);
+		lq->aggregates	= (lqBinAggregate*)calloc(bincount, sizeof(lqBinAggregate));
 
 		for (i = 0 ; i < bincount ; i++)
 			lq->bins[i] = NULL;
     }
 
-    lq->other = NULL;
+    memset(lq->other, 0, sizeof(lq->other));
+    memset(lq->otherAggregates, 0, sizeof(lq->otherAggregates));
 }
 
-// Find the bin ID for a location in space.  The location is given in terms of its XYZ coordinates.  The bin ID is a pointer to a pointer to the 
-// bin contents list.
-lqClientProxy** lqBinForLocation (lqInternalDB* lq, float x, float z)
+// Find the bin ID for a location in space and a category of object.  The location is given in terms of its XYZ coordinates.  The bin ID is a 
+// pointer to a pointer to the bin's contents list for that category.
+lqClientProxy** lqBinForLocation (lqInternalDB* lq, float x, float z, int category)
 {
     int i, ix, iz;
 
     /* if point outside super-brick, return the "other" bin */
-    if (x < lq->originx)				return &(lq->other);
-    if (z < lq->originz)				return &(lq->other);
-    if (x >= lq->originx + lq->sizex)	return &(lq->other);
-    if (z >= lq->originz + lq->sizez)	return &(lq->other);
+    if (x < lq->originx)				return &(lq->other[category]);
+    if (z < lq->originz)				return &(lq->other[category]);
+    if (x >= lq->originx + lq->sizex)	return &(lq->other[category]);
+    if (z >= lq->originz + lq->sizez)	return &(lq->other[category]);
 
     /* if point inside super-brick, compute the bin coordinates */
     ix = (int) (((x - lq->originx) / lq->sizex) * lq->divx);
@@ -151,12 +157,21 @@ lqClientProxy** lqBinForLocation (lqInternalDB* lq, float x, float z)
     /* convert to linear bin number */
     i = lqBinCoordsToBinIndex (lq, ix, 0, iz);
 
-    /* return pointer to that bin */
-    return &(lq->bins[i]);
+    /* return pointer to that bin's list for the category */
+    return &(lq->bins[(i * LQ_CATEGORIES) + category]);
 }
 
-// Adds a given client object to a given bin, linking it into the bin contents list.
-void lqAddToBin (lqClientProxy* object, lqClientProxy** bin)
+// Find the running totals which belong to a given bin ID.
+lqBinAggregate* lqAggregateForBin (lqInternalDB* lq, lqClientProxy** bin)
+{
+    if ((bin >= lq->other) && (bin < lq->other + LQ_CATEGORIES))
+		return &(lq->otherAggregates[bin - lq->other]);
+
+    return &(lq->aggregates[bin - lq->bins]);
+}
+
+// Adds a given client object to a given bin, linking it into the bin contents list and adding it to the bin's aggregate.
+void lqAddToBin (lqClientProxy* object, lqClientProxy** bin, lqBinAggregate* aggregate)
 {
     if (*bin == NULL)			// if bin is currently empty...
     {
@@ -173,11 +188,40 @@ void lqAddToBin (lqClientProxy* object, lqClientProxy** bin)
     }
 
     object->bin = bin;			// record bin ID in proxy object
+
+    aggregate->count += 1;		// add this object's location and heading to the bin's totals
+    aggregate->px += object->x;
+    aggregate->py += object->y;
+    aggregate->pz += object->z;
+    aggregate->fx += object->fx;
+    aggregate->fy += object->fy;
+    aggregate->fz += object->fz;
+
+    object->aggregate = aggregate;
 }
 
-// Removes a given client object from its current bin, unlinking it from the bin contents list.
+// Removes a given client object from its current bin, unlinking it from the bin contents list and its aggregate.
 void lqRemoveFromBin (lqClientProxy* object)
 {
+    lqBinAggregate* aggregate = object->aggregate;
+
+    if (aggregate != NULL)				// take this object's location and heading back out of the bin's totals
+    {
+		aggregate->count -= 1;
+
+		if (aggregate->count == 0)				// an empty bin starts again from exact zero, so rounding error can't build up in the sums
+			memset(aggregate, 0, sizeof(lqBinAggregate));
+		else
+		{
+			aggregate->px -= object->x;
+			aggregate->py -= object->y;
+			aggregate->pz -= object->z;
+			aggregate->fx -= object->fx;
+			aggregate->fy -= object->fy;
+			aggregate->fz -= object->fz;
+		}
+    }
+
     if (object->bin != NULL)			// adjust pointers if object is currently in a bin
     {
 		if (*(object->bin) == object)			// If this object is at the head of the list, move the bin pointer to the next item in the list (might be NULL).
@@ -190,26 +234,45 @@ void lqRemoveFromBin (lqClientProxy* object)
 			object->next->prev = object->prev;
     }
 
-    object->prev	= NULL;		// Null out prev, next and bin pointers of this object.
-    object->next	= NULL;
-    object->bin		= NULL;
+    object->prev		= NULL;		// Null out prev, next, bin and aggregate pointers of this object.
+    object->next		= NULL;
+    object->bin			= NULL;
+    object->aggregate	= NULL;
 }
 
 // Call for each client object every time its location changes.  For example, in an animation application, this would be called each frame for every moving object.
 void lqUpdateForNewLocation(lqInternalDB* lq, lqClientProxy* object, float x, float y, float z)
 {
-	lqClientProxy** newBin = lqBinForLocation(lq, x, z);		// find bin for new location
+    lqUpdateForNewLocationAndHeading(lq, object, x, y, z, object->fx, object->fy, object->fz);
+}
 
-    // store location in client object, for future reference
-    object->x = x;
-    object->y = y;
-    object->z = z;
+// As above, also recording the object's heading for its bin's aggregate.
+void lqUpdateForNewLocationAndHeading(lqInternalDB* lq, lqClientProxy* object, float x, float y, float z, float fx, float fy, float fz)
+{
+	lqClientProxy** newBin = lqBinForLocation(lq, x, z, object->category);		// find bin for new location (and the object's category, if changed)
 
     if (newBin != object->bin)			// has object moved into a new bin?
+		lqRemoveFromBin (object);		// (takes the old location and heading out of the old bin's totals)
+    else if (object->aggregate != NULL)	// otherwise just move the bin's totals by the difference
     {
-		lqRemoveFromBin (object);
- 		lqAddToBin (object, newBin);
+		object->aggregate->px += x - object->x;
+		object->aggregate->py += y - object->y;
+		object->aggregate->pz += z - object->z;
+		object->aggregate->fx += fx - object->fx;
+		object->aggregate->fy += fy - object->fy;
+		object->aggregate->fz += fz - object->fz;
     }
+
+    // store location and heading in client object, for future reference
+    object->x = x;
+    object->y = y;
+    object->z = z;
+    object->fx = fx;
+    object->fy = fy;
+    object->fz = fz;
+
+    if (object->bin == NULL)
+ 		lqAddToBin (object, newBin, lqAggregateForBin(lq, newBin));
 }
 
 // Given a bin's list of client proxies, traverse the list and invoke the given lqCallBackFunction on each object that falls within the search radius.
@@ -231,11 +294,23 @@ void lqUpdateForNewLocation(lqInternalDB* lq, lqClientProxy* object, float x, fl
 	co = co->next;                                                \
     }
 
+// Given a bin's lists of client proxies by category, traverse those of the categories in the given mask (a bit per category) as above.  The
+// other categories' objects aren't touched at all.
+#define lqTraverseBinCategories(lists, categories, radiusSquared, func, state) \
+    for (c = 0 ; c < LQ_CATEGORIES ; c++)                                    \
+    {                                                                        \
+	if ((categories) & (1u << c))                                         \
+	{                                                                     \
+	    co = (lists)[c];                                                  \
+	    lqTraverseBinClientObjectList(co, radiusSquared, func, state);    \
+	}                                                                     \
+    }
+
 // This subroutine of lqMapOverAllObjectsInLocality efficiently traverses of subset of bins specified by max and min bin coordinates.
 void lqMapOverAllObjectsInLocalityClipped(	lqInternalDB* lq, float x, float y, float z, float radius, lqCallBackFunction func, void* clientQueryState,
-											int minBinX, int minBinY,  int minBinZ, int maxBinX, int maxBinY, int maxBinZ)
+											int minBinX, int minBinY,  int minBinZ, int maxBinX, int maxBinY, int maxBinZ, unsigned int categories)
 {
-    int i,		j,		k,
+    int i,		j,		k,		c,
 		iindex,	jindex,	kindex;
 
     int slab	= lq->divy * lq->divz;
@@ -256,10 +331,9 @@ void lqMapOverAllObjectsInLocalityClipped(	lqInternalDB* lq, float x, float y, f
 			kindex = kstart;						// loop for z bins across diameter of sphere
 			for (k = minBinZ ; k <= maxBinZ ; k++)
 			{
-				bin = &lq->bins[iindex + jindex + kindex];	// get current bin's client object list
-				co = *bin;
+				bin = &lq->bins[(iindex + jindex + kindex) * LQ_CATEGORIES];	// get current bin's client object lists
 
-				lqTraverseBinClientObjectList(co, radiusSquared, func, clientQueryState);	// traverse current bin's client object list
+				lqTraverseBinCategories(bin, categories, radiusSquared, func, clientQueryState);	// traverse current bin's client object lists
 				kindex += 1;
 			}
 			jindex += row;
@@ -270,12 +344,13 @@ void lqMapOverAllObjectsInLocalityClipped(	lqInternalDB* lq, float x, float y, f
 
 // If the query region (sphere) extends outside of the "super-brick" we need to check for objects in the catch-all "other" bin which holds any 
 // object which are not inside the regular sub-bricks
-void lqMapOverAllOutsideObjects(lqInternalDB* lq, float x, float y, float z, float radius, lqCallBackFunction func, void* clientQueryState)
+void lqMapOverAllOutsideObjects(lqInternalDB* lq, float x, float y, float z, float radius, lqCallBackFunction func, void* clientQueryState, unsigned int categories)
 {
-    lqClientProxy* co	= lq->other;
+    int c;
+    lqClientProxy* co;
     float radiusSquared	= radius * radius;
 
-    lqTraverseBinClientObjectList(co, radiusSquared, func, clientQueryState);	// traverse the "other" bin's client object list
+    lqTraverseBinCategories(lq->other, categories, radiusSquared, func, clientQueryState);	// traverse the "other" bin's client object lists
 }
 
 // Apply an application-specific function to all objects in a certain locality.  The locality is specified as a sphere with a given center and 
@@ -286,7 +361,7 @@ void lqMapOverAllOutsideObjects(lqInternalDB* lq, float x, float y, float z, flo
 //		(3) a void* pointer to the caller-supplied "client query state" object -- typically NULL, but can be used to store state between calls to the lqCallBackFunction.
 // This routine uses the LQ database to quickly reject any objects in bins which do not overlap with the sphere of interest.  Incremental 
 // calculation of index values is used to efficiently traverse the bins of interest.
-void lqMapOverAllObjectsInLocality (lqInternalDB* lq, float x, float y, float z, float radius, lqCallBackFunction func, void* clientQueryState)
+void lqMapOverAllObjectsInLocality (lqInternalDB* lq, float x, float y, float z, float radius, lqCallBackFunction func, void* clientQueryState, unsigned int categories)
 {
     int partlyOut = 0;
     int completelyOutside = (
@@ -300,7 +375,7 @@ void lqMapOverAllObjectsInLocality (lqInternalDB* lq, float x, float y, float z,
 
     if (completelyOutside)									// is the sphere completely outside the "super brick"?
     {
-		lqMapOverAllOutsideObjects (lq, x, y, z, radius, func, clientQueryState);
+		lqMapOverAllOutsideObjects (lq, x, y, z, radius, func, clientQueryState, categories);
 		return;
 	}
 
@@ -321,11 +396,103 @@ void lqMapOverAllObjectsInLocality (lqInternalDB* lq, float x, float y, float z,
     if (maxBinZ >= lq->divz) {partlyOut = 1; maxBinZ = lq->divz - 1;}
 
 	if (partlyOut)									// map function over outside objects if necessary (if clipped)
-		lqMapOverAllOutsideObjects(lq, x, y, z, radius, func, clientQueryState);
+		lqMapOverAllOutsideObjects(lq, x, y, z, radius, func, clientQueryState, categories);
     
     lqMapOverAllObjectsInLocalityClipped(	lq, x, y, z, radius, func, clientQueryState,	// map function over objects in bins
 											minBinX, minBinY, minBinZ,
-											maxBinX, maxBinY, maxBinZ);
+											maxBinX, maxBinY, maxBinZ, categories);
+}
+
+// Distance from a coordinate to the nearest point of a bin's extent along the same axis (zero when the coordinate lies within it).
+static float lqDistanceToBinExtent(float p, float low, float size)
+{
+    if (p < low)			return low - p;
+    if (p > low + size)		return p - (low + size);
+    return 0;
+}
+
+// As lqMapOverAllObjectsInLocality, but only bins which come within exactRadius of the centre are traversed object by object.  Every other 
+// occupied bin which overlaps the locality sphere is instead passed whole to aggregateFunc.  Objects in the "other" bin are always exact.
+void lqMapOverLocalityWithAggregates(lqInternalDB* lq, float x, float y, float z, float radius, float exactRadius, 
+									 lqCallBackFunction func, lqAggregateCallBackFunction aggregateFunc, void* clientQueryState, unsigned int categories)
+{
+    int i, j, k, c, index;
+    int partlyOut = 0;
+    int completelyOutside = (
+								((x + radius) < lq->originx) ||
+								((y + radius) < lq->originy) ||
+								((z + radius) < lq->originz) ||
+								((x - radius) >= lq->originx + lq->sizex) ||
+								((y - radius) >= lq->originy + lq->sizey) ||
+								((z - radius) >= lq->originz + lq->sizez));
+    int minBinX, minBinY, minBinZ, maxBinX, maxBinY, maxBinZ;
+    float binSizeX = lq->sizex / lq->divx;
+    float binSizeY = lq->sizey / lq->divy;
+    float binSizeZ = lq->sizez / lq->divz;
+    float radiusSquared = radius * radius;
+    float exactSquared = exactRadius * exactRadius;
+    float nx, ny, nz, nearestSquared;
+    lqClientProxy* co;
+
+    if (completelyOutside)									// is the sphere completely outside the "super brick"?
+    {
+		lqMapOverAllOutsideObjects (lq, x, y, z, radius, func, clientQueryState, categories);
+		return;
+	}
+
+    // compute min and max bin coordinates for each dimension
+    minBinX = (int) ((((x - radius) - lq->originx) / lq->sizex) * lq->divx);
+    minBinY = (int) ((((y - radius) - lq->originy) / lq->sizey) * lq->divy);
+    minBinZ = (int) ((((z - radius) - lq->originz) / lq->sizez) * lq->divz);
+    maxBinX = (int) ((((x + radius) - lq->originx) / lq->sizex) * lq->divx);
+    maxBinY = (int) ((((y + radius) - lq->originy) / lq->sizey) * lq->divy);
+    maxBinZ = (int) ((((z + radius) - lq->originz) / lq->sizez) * lq->divz);
+
+    // clip bin coordinates
+    if (minBinX < 0)         {partlyOut = 1; minBinX = 0;}
+    if (minBinY < 0)         {partlyOut = 1; minBinY = 0;}
+    if (minBinZ < 0)         {partlyOut = 1; minBinZ = 0;}
+    if (maxBinX >= lq->divx) {partlyOut = 1; maxBinX = lq->divx - 1;}
+    if (maxBinY >= lq->divy) {partlyOut = 1; maxBinY = lq->divy - 1;}
+    if (maxBinZ >= lq->divz) {partlyOut = 1; maxBinZ = lq->divz - 1;}
+
+	if (partlyOut)									// map function over outside objects if necessary (if clipped)
+		lqMapOverAllOutsideObjects(lq, x, y, z, radius, func, clientQueryState, categories);
+
+    for (i = minBinX ; i <= maxBinX ; i++)
+    {
+		nx = lqDistanceToBinExtent(x, lq->originx + (i * binSizeX), binSizeX);
+
+		for (j = minBinY ; j <= maxBinY ; j++)
+		{
+			ny = lqDistanceToBinExtent(y, lq->originy + (j * binSizeY), binSizeY);
+
+			for (k = minBinZ ; k <= maxBinZ ; k++)
+			{
+				index = lqBinCoordsToBinIndex (lq, i, j, k) * LQ_CATEGORIES;
+
+				nz = lqDistanceToBinExtent(z, lq->originz + (k * binSizeZ), binSizeZ);
+				nearestSquared = (nx * nx) + (ny * ny) + (nz * nz);
+
+				if (nearestSquared >= radiusSquared)		// bin doesn't overlap the locality
+					continue;
+
+				for (c = 0 ; c < LQ_CATEGORIES ; c++)
+				{
+					if (!(categories & (1u << c)) || (lq->aggregates[index + c].count == 0))		// nothing to report from an empty list
+						continue;
+
+					if (nearestSquared < exactSquared)		// near bin: visit each of its objects
+					{
+						co = lq->bins[index + c];
+						lqTraverseBinClientObjectList(co, radiusSquared, func, clientQueryState);
+					}
+					else									// distant bin which still overlaps the locality: report its totals
+						(*aggregateFunc) (&lq->aggregates[index + c], clientQueryState);
+				}
+			}
+		}
+    }
 }
 
 typedef struct lqFindNearestState
@@ -353,7 +520,7 @@ void lqFindNearestHelper(void* clientObject, float distanceSquared, void* client
 // (if any) within a given search sphere which is nearest to the sphere's center.  The ignoreObject argument can be used to exclude an object from 
 // consideration (or it can be NULL).  This is useful when looking for the nearest neighbor of an object in the database, since otherwise it would
 // be its own nearest neighbor. The function returns a void* pointer to the nearest object, or NULL if none is found.
-void* lqFindNearestNeighborWithinRadius (lqInternalDB* lq,  float x, float y, float z, float radius, void* ignoreObject)
+void* lqFindNearestNeighborWithinRadius (lqInternalDB* lq,  float x, float y, float z, float radius, void* ignoreObject, unsigned int categories)
 {
     lqFindNearestState lqFNS;				// initialize search state
 
@@ -361,7 +528,7 @@ void* lqFindNearestNeighborWithinRadius (lqInternalDB* lq,  float x, float y, fl
     lqFNS.ignoreObject			= ignoreObject;
     lqFNS.minDistanceSquared	= FLT_MAX;
 
-    lqMapOverAllObjectsInLocality(lq, x, y, z, radius, lqFindNearestHelper, &lqFNS);		// map search helper function over all objects within radius
+    lqMapOverAllObjectsInLocality(lq, x, y, z, radius, lqFindNearestHelper, &lqFNS, categories);		// map search helper function over all objects within radius
 
     return lqFNS.nearestObject;			// return nearest object found, if any
 }
@@ -379,22 +546,42 @@ void lqMapOverAllObjectsInBin(lqClientProxy* binProxyList, lqCallBackFunction fu
 void lqMapOverAllObjects(lqInternalDB* lq, lqCallBackFunction func, void* clientQueryState)
 {
     int i;
-    int bincount = lq->divx * lq->divz;
+    int bincount = lq->divx * lq->divz * LQ_CATEGORIES;
 
     for (i = 0 ; i < bincount ; i++)
 		lqMapOverAllObjectsInBin(lq->bins[i], func, clientQueryState);
 
-    lqMapOverAllObjectsInBin(lq->other, func, clientQueryState);
+    for (i = 0 ; i < LQ_CATEGORIES ; i++)
+		lqMapOverAllObjectsInBin(lq->other[i], func, clientQueryState);
+}
+
+// Numbers the objects down each bin's list, counting down across the bins as they're walked, so that objects added to the same bin in order
+// of their numbers (lowest first) are listed in the same order as these are.  Only the order within a bin means anything.
+void lqNumberObjects(lqInternalDB* lq)
+{
+    int i;
+    int bincount = lq->divx * lq->divz * LQ_CATEGORIES;
+    int order = 0;
+    lqClientProxy* p;
+
+    for (i = 0 ; i < bincount ; i++)
+		for (p = lq->bins[i] ; p != NULL ; p = p->next)
+			p->order = order--;
+
+    for (i = 0 ; i < LQ_CATEGORIES ; i++)
+		for (p = lq->other[i] ; p != NULL ; p = p->next)
+			p->order = order--;
 }
 
 // Removes (all proxies for) all objects from all bins
 void lqRemoveAllObjects(lqInternalDB* lq)
 {
     int i;
-    int bincount = lq->divx * lq->divz;
+    int bincount = lq->divx * lq->divz * LQ_CATEGORIES;
 
     for (i = 0 ; i < bincount ; i++)
 		lqRemoveAllObjectsInBin(lq->bins[i]);
 
-    lqRemoveAllObjectsInBin (lq->other);
+    for (i = 0 ; i < LQ_CATEGORIES ; i++)
+		lqRemoveAllObjectsInBin (lq->other[i]);
 }
\ No newline at end of file